@@ -28,25 +28,41 @@
 #define ANALOG_INPUTS_E_OUT_dt_FACTOR   50
 #define ANALOG_INPUTS_E_OUT_DIVIDER     100
 
+#define ANALOG_INPUTS_TICKS_PER_HOUR    (3600ULL*1000000/TIMER_INTERRUPT_PERIOD_MICROSECONDS)
+
 #define ANALOG_INPUTS_ADC_MEASUREMENTS_COUNT (ANALOG_INPUTS_ADC_ROUND_MAX_COUNT*ANALOG_INPUTS_ADC_BURST_COUNT)
 
+#if ANALOG_INPUTS_ADC_ROUND_MAX_COUNT % ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS != 0
+#error "ANALOG_INPUTS_ADC_ROUND_MAX_COUNT must be a multiple of ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS"
+#endif
+
+#define ANALOG_INPUTS_ADC_BLOCK_ROUND_COUNT (ANALOG_INPUTS_ADC_ROUND_MAX_COUNT/ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS)
+#define ANALOG_INPUTS_ADC_BLOCK_MEASUREMENTS_COUNT (ANALOG_INPUTS_ADC_BLOCK_ROUND_COUNT*ANALOG_INPUTS_ADC_BURST_COUNT)
+
 #if (1<<ANALOG_INPUTS_RESOLUTION) * ANALOG_INPUTS_ADC_MEASUREMENTS_COUNT > UINT32_MAX
 #error "avr sum don't fit into uint32_t"
 #endif
 
-//TODO: 120?? we take not more then 60 measurements into account
-#if ((1<<ANALOG_INPUTS_RESOLUTION)>>ANALOG_INPUTS_ADC_DELTA_SHIFT) * ANALOG_INPUTS_ADC_MEASUREMENTS_COUNT * 120 > UINT32_MAX
-#error "delta avr sum don't fit into uint32_t"
-#endif
 
+#ifdef ENABLE_ATOMIC_32BIT_READ
+//aligned loads can't be torn by an interrupt
+#define READ_ATOMIC(v, x) \
+    v = x;
+#else
+#define READ_ATOMIC(v, x) \
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {\
+        v = x;\
+    }
+#endif
 
 #define RETURN_ATOMIC(x)  \
     ValueType v; \
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {\
-        v = x;\
-    }\
+    READ_ATOMIC(v, x) \
     return v;\
 
+//keep the compiler from moving stores across frameSequence_ updates
+#define COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
 
 
 namespace AnalogInputs {
@@ -65,26 +81,53 @@ namespace AnalogInputs {
 
     ValueType avrAdc_[PHYSICAL_INPUTS];
     ValueType real_[ALL_INPUTS];
-    uint16_t stableCount_[ALL_INPUTS];
+    StableStat stable_[ANALOG_INPUTS_STABLE_INPUTS];
+
+    //real_ is copied to frame_ after every measurement (in the main loop),
+    //frameSequence_ is odd during the copy - an interrupt arriving then
+    //reads real_, which is complete at that time, so readers never retry
+    volatile Frame frame_;
+    volatile uint8_t frameSequence_;
+
+    //bit (name - Pout): Pout, Cout or Eout needs to be calculated
+    uint8_t     lazyDirty_;
 
     uint16_t calculationCount_;
 
-    uint16_t    i_deltaAvrCount_;
-    uint32_t    i_deltaAvrSumVoutPlus_;
-    uint32_t    i_deltaAvrSumVoutMinus_;
-    uint32_t    i_deltaAvrSumTextern_;
+#if ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS > 1
+    //averages of the last blocks, oldest at windowIndex_ (when the window is full)
+    ValueType   windowAvr_[ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS][PHYSICAL_INPUTS];
+    uint8_t     windowIndex_;
+    uint8_t     windowFill_;
+    uint16_t    measurementCount_;
+    bool        updateStable_ = true;
+#endif
 
+    DeltaEstimator deltaVoutEstimator_;
+    DeltaEstimator deltaTexternEstimator_;
     uint16_t    deltaCount_;
     ValueType   deltaLastT_;
-    uint16_t    deltaStartTimeU16_;
+    uint16_t    deltaLastTimeU16_;
+    uint16_t    deltaPeriod_;
+    uint16_t    deltaWindow_ = ANALOG_INPUTS_DELTA_TIME_MILISECONDS;
     bool        enable_deltaVoutMax_;
 
-    uint32_t    i_charge_;
-    uint32_t    i_Eout_;
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+    //mA * timer ticks, mA * mV * timer ticks
+    volatile uint64_t i_charge_;
+    volatile uint64_t i_Eout_;
+    uint16_t    i_integrateTime_;
+    volatile uint32_t i_roundSum_[Idischarge + 1];
+#else
+    volatile uint32_t i_charge_;
+    volatile uint32_t i_Eout_;
     uint8_t     i_Eout_dt_;
+#endif
+
+    CalibrationTable calibrationTable_[PHYSICAL_INPUTS];
 
     void _resetAvr();
-    void _resetDeltaAvr();
+    void publishFrame();
     void resetADC();
     void reset();
     void resetDelta();
@@ -92,15 +135,25 @@ namespace AnalogInputs {
 
 
     ValueType getAvrADCValue(Name name)     { return avrAdc_[name];   }
-    ValueType getRealValue(Name name)       { return real_[name]; }
+    ValueType getLazyValue(Name name);
+    ValueType getRealValue(Name name) {
+        if(name >= Pout && name <= Eout)
+            return getLazyValue(name);
+        return real_[name];
+    }
     ValueType getADCValue(Name name)        { RETURN_ATOMIC(i_adc_[name]) }
     bool isPowerOn() { return on_; }
     uint16_t getFullMeasurementCount()      { return calculationCount_; }
+#if ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS > 1
+    uint16_t getMeasurementCount()          { return measurementCount_; }
+#else
+    uint16_t getMeasurementCount()          { return calculationCount_; }
+#endif
     ValueType getDeltaLastT()               { return deltaLastT_;}
     ValueType getDeltaCount()               { return deltaCount_;}
+    void setDeltaWindow(uint16_t miliseconds)   { deltaWindow_ = miliseconds; }
     void enableDeltaVoutMax(bool enable)    { enable_deltaVoutMax_ = enable; }
 
-    uint16_t getStableCount(Name name)      { return stableCount_[name]; };
     bool isStable(Name name)                { return getStableCount(name) >= STABLE_MIN_VALUE; };
     void setReal(Name name, ValueType real);
     void setRealBasedOnAvr(AnalogInputs::Name name);
@@ -119,6 +172,7 @@ namespace AnalogInputs {
 void AnalogInputs::doFullMeasurement()
 {
     resetMeasurement();
+    //the window is filled again after a full measurement
     uint16_t c = getFullMeasurementCount();
     while(c == getFullMeasurementCount())
         Time::delayDoIdle(10);
@@ -133,6 +187,10 @@ void AnalogInputs::restoreDefault()
         setCalibrationPoint(name, 0, p);
         p = pgm::read<CalibrationPoint>(&inputsP_[name].p1);
         setCalibrationPoint(name, 1, p);
+        p.x = p.y = CALIBRATION_POINT_UNUSED;
+        for(uint8_t i = 2; i < ANALOG_INPUTS_MAX_CALIBRATION_POINTS; i++) {
+            setCalibrationPoint(name, i, p);
+        }
     }
     eeprom::restoreCalibrationCRC();
 }
@@ -149,6 +207,101 @@ void AnalogInputs::setCalibrationPoint(Name name, uint8_t i, const CalibrationPo
 {
     if(name >= PHYSICAL_INPUTS || i >= ANALOG_INPUTS_MAX_CALIBRATION_POINTS) return;
     eeprom::write<CalibrationPoint>(&eeprom::data.calibration[name].p[i], x);
+    updateCalibrationTable(name);
+}
+
+static uint8_t bitLength(uint32_t v)
+{
+    uint8_t bits = 0;
+    while(v) {
+        bits++;
+        v >>= 1;
+    }
+    return bits;
+}
+
+static void setCalibrationFactor(uint32_t &m, uint8_t &shift, int32_t dy, int32_t dx)
+{
+    bool negative = (dy < 0) != (dx < 0);
+    if(dy < 0) dy = -dy;
+    if(dx < 0) dx = -dx;
+    m = 0;
+    shift = 16;
+    if(dx == 0)
+        return;
+
+    //m = ceil(dy * 2^shift / dx), with 2^shift >= 2^16 * dx
+    //the result is then exactly dy * n / dx (rounded towards 0) for all 16bit n
+    uint32_t q = dy / dx, r = dy % dx;
+    uint8_t maxShift = 16 + bitLength(dx);
+    uint8_t s = 0;
+    while(s < maxShift && q < (UINT32_MAX >> 1)) {
+        q <<= 1;
+        r <<= 1;
+        if(r >= (uint32_t)dx) {
+            r -= dx;
+            q |= 1;
+        }
+        s++;
+    }
+    if(r) q++;
+
+    if(s < 16) {
+        //slope > 2^15, saturate
+        q = UINT32_MAX;
+        s = 16;
+    }
+    m = q;
+    shift = s;
+    if(negative) shift |= ANALOG_INPUTS_CALIBRATION_NEGATIVE;
+}
+
+void AnalogInputs::updateCalibrationTable(Name name)
+{
+    CalibrationTable &t = calibrationTable_[name];
+    uint8_t order[ANALOG_INPUTS_MAX_CALIBRATION_POINTS];
+    uint8_t n = 0;
+
+    //insertion sort by x, remember the original index
+    for(uint8_t i = 0; i < ANALOG_INPUTS_MAX_CALIBRATION_POINTS; i++) {
+        CalibrationPoint p;
+        getCalibrationPoint(p, name, i);
+        if(!isCalibrationPointUsed(p))
+            continue;
+        uint8_t j = n++;
+        for(; j > 0 && t.p[j-1].x > p.x; j--) {
+            t.p[j] = t.p[j-1];
+            order[j] = order[j-1];
+        }
+        t.p[j] = p;
+        order[j] = i;
+    }
+    if(n < 2) {
+        //p0 or p1 unused - should never happen
+        if(n == 0) t.p[0].x = t.p[0].y = 0;
+        t.p[1] = t.p[0];
+        n = 2;
+    }
+
+    t.segments = n - 1;
+    t.anchor = 0;
+    for(uint8_t k = 0; k < t.segments; k++) {
+        int32_t dx = t.p[k+1].x, dy = t.p[k+1].y;
+        dx -= t.p[k].x;
+        dy -= t.p[k].y;
+        setCalibrationFactor(t.valueM[k], t.valueShift[k], dy, dx);
+        setCalibrationFactor(t.reverseM[k], t.reverseShift[k], dx, dy);
+        //keep the two point formula anchored at p0 (rounding)
+        if(order[k+1] < order[k])
+            t.anchor |= 1 << k;
+    }
+}
+
+void AnalogInputs::loadCalibration()
+{
+    ANALOG_INPUTS_FOR_ALL_PHY(name) {
+        updateCalibrationTable(name);
+    }
 }
 
 uint16_t AnalogInputs::getConnectedBalancePortCells()
@@ -201,6 +354,68 @@ AnalogInputs::ValueType AnalogInputs::getIout()
     return getRealValue(Iout);
 }
 
+namespace {
+    AnalogInputs::ValueType calculatePout()
+    {
+        uint32_t P = AnalogInputs::real_[AnalogInputs::Iout];
+        P *= AnalogInputs::real_[AnalogInputs::VoutBalancer];
+        P /= 10000;
+        return P;
+    }
+
+    typedef AnalogInputs::ValueType (*LazyInput)();
+
+    //calculated on the first read after a measurement, in Name order
+    const LazyInput lazyInputs[] PROGMEM = {
+        calculatePout,          //Pout: Iout, VoutBalancer
+        AnalogInputs::getCharge,//Cout: i_charge_
+        AnalogInputs::getEout,  //Eout: i_Eout_
+    };
+    STATIC_ASSERT(sizeOfArray(lazyInputs) == AnalogInputs::Eout - AnalogInputs::Pout + 1);
+}
+
+AnalogInputs::ValueType AnalogInputs::getLazyValue(Name name)
+{
+    uint8_t bit = 1 << (name - Pout);
+    if(lazyDirty_ & bit) {
+        lazyDirty_ &= ~bit;
+        LazyInput calculate = pgm::read(&lazyInputs[name - Pout]);
+        real_[name] = calculate();
+    }
+    return real_[name];
+}
+
+void AnalogInputs::publishFrame()
+{
+    frameSequence_++;
+    COMPILER_BARRIER();
+    frame_.count = calculationCount_;
+    ANALOG_INPUTS_FOR_ALL(name) {
+        frame_.real[name] = real_[name];
+    }
+    COMPILER_BARRIER();
+    frameSequence_++;
+}
+
+void AnalogInputs::getFrame(Frame &frame)
+{
+    frame.count = frame_.count;
+    ANALOG_INPUTS_FOR_ALL(name) {
+        frame.real[name] = frame_.real[name];
+    }
+    //in the main loop real_ is the published measurement
+    for(Name name = Pout; name <= Eout; name = Name(name + 1)) {
+        frame.real[name] = getLazyValue(name);
+    }
+}
+
+AnalogInputs::ValueType AnalogInputs::getFrameValue(Name name)
+{
+    if(frameSequence_ & 1)
+        return real_[name];
+    return frame_.real[name];
+}
+
 bool AnalogInputs::isOutStable()
 {
     return isStable(AnalogInputs::VoutBalancer) && isStable(AnalogInputs::Iout) && Balancer::isStable();
@@ -212,27 +427,157 @@ void AnalogInputs::_resetAvr()
         ANALOG_INPUTS_FOR_ALL_PHY(name) {
             i_avrSum_[name] = 0;
         }
-        i_avrCount_ = ANALOG_INPUTS_ADC_ROUND_MAX_COUNT;
+        i_avrCount_ = ANALOG_INPUTS_ADC_BLOCK_ROUND_COUNT;
         ignoreLastResult_ = false;
     }
 }
 
-void AnalogInputs::_resetDeltaAvr()
+void AnalogInputs::resetStable()
 {
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        i_deltaAvrCount_ = 0;
-        i_deltaAvrSumVoutPlus_ = 0;
-        i_deltaAvrSumVoutMinus_ = 0;
-        i_deltaAvrSumTextern_ = 0;
-        deltaStartTimeU16_ = Time::getMilisecondsU16();
+    for(uint8_t i = 0; i < ANALOG_INPUTS_STABLE_INPUTS; i++) {
+        stable_[i].n = 0;
+        stable_[i].count = 0;
     }
 }
 
-void AnalogInputs::resetStable()
+static int8_t getStableIndex(AnalogInputs::Name name)
 {
-    ANALOG_INPUTS_FOR_ALL(name) {
-        stableCount_[name] = 0;
+    if(name >= AnalogInputs::Vb1 && name < AnalogInputs::Vb1 + MAX_BALANCE_CELLS)
+        return name - AnalogInputs::Vb1;
+    if(name == AnalogInputs::VoutBalancer)
+        return MAX_BALANCE_CELLS;
+    if(name == AnalogInputs::Iout)
+        return MAX_BALANCE_CELLS + 1;
+    return -1;
+}
+
+static uint16_t sqrtU32(uint32_t v)
+{
+    uint32_t r = 0;
+    uint32_t bit = 1UL << 30;
+    while(bit > v) bit >>= 2;
+    while(bit) {
+        if(v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
     }
+    return r;
+}
+
+//sample variance, fixed point squared
+static uint32_t getStableVariance(const AnalogInputs::StableStat &s)
+{
+    if(s.n < 2) return 0;
+    return s.m2 / (s.n - 1);
+}
+
+//max. distance from the mean (fixed point) of a sample in the same run
+//limited so that m2 (STABLE_WINDOW * band^2) fits in 32 bits
+#define ANALOG_INPUTS_STABLE_MAX_BAND   4096
+
+//STABLE_VALUE_ERROR (fixed point), Iout: relative to the current,
+//the SMPS ripple and noise grow with it
+static int32_t getStableError(int8_t i, const AnalogInputs::StableStat &s)
+{
+    int32_t error = AnalogInputs::STABLE_VALUE_ERROR << ANALOG_INPUTS_STABLE_FRACTION_BITS;
+    if(i == MAX_BALANCE_CELLS + 1) {
+        int32_t relative = (s.mean < 0 ? -s.mean : s.mean) / AnalogInputs::STABLE_IOUT_RELATIVE;
+        if(relative > error) error = relative;
+    }
+    return error;
+}
+
+static int32_t getStableBand(int8_t i, const AnalogInputs::StableStat &s)
+{
+    int32_t band = sqrtU32(getStableVariance(s));
+    band *= AnalogInputs::STABLE_BAND_SIGMA;
+    int32_t minBand = getStableError(i, s);
+    if(band < minBand) band = minBand;
+    if(band > ANALOG_INPUTS_STABLE_MAX_BAND) band = ANALOG_INPUTS_STABLE_MAX_BAND;
+    return band;
+}
+
+void AnalogInputs::updateStable(Name name, ValueType real)
+{
+    int8_t i = getStableIndex(name);
+    if(i < 0)
+        return;
+
+    StableStat &s = stable_[i];
+    int32_t x = int32_t(real) << ANALOG_INPUTS_STABLE_FRACTION_BITS;
+    if(s.n == 0) {
+        s.mean = x;
+        s.m2 = 0;
+        s.n = 1;
+        s.count = 0;
+        s.outlier = 0;
+        return;
+    }
+
+    int32_t d = x - s.mean;
+    int32_t band = getStableBand(i, s);
+    int8_t outlier = 0;
+    if(d > band) outlier = 1;
+    if(d < -band) outlier = -1;
+
+    if(outlier && outlier == s.outlier) {
+        //second sample in a row on the same side: step change or drift,
+        //start a new run (this sample and the left out one),
+        //the variance is kept as a single sample
+        s.m2 = getStableVariance(s);
+        s.mean = x;
+        s.n = 2;
+        s.count = 1;
+        s.outlier = 0;
+        return;
+    }
+    s.outlier = outlier;
+    //a single outlier (a spike or the first sample of a step) is left out,
+    //it would inflate the variance of the next run
+    if(outlier)
+        return;
+
+    if(s.n < STABLE_WINDOW) {
+        s.n++;
+    } else {
+        s.m2 -= s.m2 / STABLE_WINDOW;
+    }
+    int32_t dMean = d / s.n;
+    s.mean += dMean;
+    s.m2 += uint32_t(d * (d - dMean));
+    if(s.count < UINT16_MAX)
+        s.count++;
+}
+
+uint16_t AnalogInputs::getStableCount(Name name)
+{
+    int8_t i = getStableIndex(name);
+    if(i < 0)
+        return 0;
+
+    const StableStat &s = stable_[i];
+    //no samples or a possible step change pending
+    if(s.n == 0 || s.outlier)
+        return 0;
+    //standard error of the run mean: sqrt(variance / samples) <= error/2
+    uint32_t maxError = getStableError(i, s) / 2;
+    if(getStableVariance(s) / (s.count + 1) > maxError * maxError)
+        return 0;
+    return s.count;
+}
+
+AnalogInputs::ValueType AnalogInputs::getNoise(Name name)
+{
+    int8_t i = getStableIndex(name);
+    if(i < 0)
+        return 0;
+    uint16_t sigma = sqrtU32(getStableVariance(stable_[i]));
+    sigma += 1 << (ANALOG_INPUTS_STABLE_FRACTION_BITS - 1);
+    return sigma >> ANALOG_INPUTS_STABLE_FRACTION_BITS;
 }
 
 
@@ -241,6 +586,10 @@ void AnalogInputs::resetMeasurement()
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
         i_avrCount_ = 1; //TODO:??
         ignoreLastResult_ = true;
+#if ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS > 1
+        windowIndex_ = 0;
+        windowFill_ = 0;
+#endif
         resetStable();
     }
 }
@@ -250,17 +599,22 @@ void AnalogInputs::resetAccumulatedMeasurements()
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
         i_charge_ = 0;
         i_Eout_ = 0;
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+        i_integrateTime_ = Time::getInterruptsU16();
+#else
         i_Eout_dt_ = ANALOG_INPUTS_E_OUT_dt_FACTOR;
+#endif
     }
     setReal(deltaVoutMax, getVout());
     deltaLastT_ = getRealValue(Textern);
 
     resetMeasurement();
-    _resetDeltaAvr();
     deltaCount_ = 0;
+    deltaWindow_ = ANALOG_INPUTS_DELTA_TIME_MILISECONDS;
     setReal(Cout, 0);
     setReal(deltaVout, 0);
     setReal(deltaTextern, 0);
+    publishFrame();
 }
 
 void AnalogInputs::reset()
@@ -298,44 +652,74 @@ bool AnalogInputs::isReversePolarity()
     return vm > REVERSE_POLARITY_MIN_VOLTAGE;
 }
 
-AnalogInputs::ValueType AnalogInputs::calibrateValue(Name name, ValueType x)
+//(|a| * m) >> shift, m is 32bit, shift >= 16 - without a 64bit multiplication
+static inline uint32_t multiplyShift(uint16_t a, uint32_t m, uint8_t shift)
 {
-    //TODO: do this with more points
-    if (x == 0) return 0;
-    CalibrationPoint p0, p1;
-    getCalibrationPoint(p0, name, 0);
-    getCalibrationPoint(p1, name, 1);
-    int32_t y,a;
-    y  = p1.y; y -= p0.y;
-    a  =  x;   a -= p0.x;
-    y *= a;
-    a  = p1.x; a -= p0.x;
-    y /= a;
-    y += p0.y;
-
-    if(y < 0) y = 0;
+    uint32_t v = a;
+    v *= m >> 16;
+    uint32_t l = a;
+    l *= m & 0xffff;
+    v += l >> 16;
+    return v >> (shift - 16);
+}
+
+static AnalogInputs::ValueType calibrate(uint32_t m, uint8_t shift,
+        AnalogInputs::ValueType from, AnalogInputs::ValueType to, AnalogInputs::ValueType x)
+{
+    bool negative = shift & ANALOG_INPUTS_CALIBRATION_NEGATIVE;
+    uint16_t a;
+    if(x < from) {
+        a = from - x;
+        negative = !negative;
+    } else {
+        a = x - from;
+    }
+
+    int32_t y = to;
+    uint32_t d = multiplyShift(a, m, shift & ~ANALOG_INPUTS_CALIBRATION_NEGATIVE);
+    if(negative) {
+        if(d > (uint32_t)y) return 0;
+        y -= d;
+    } else {
+        y += d;
+    }
     if(y > UINT16_MAX) y = UINT16_MAX;
     return y;
 }
 
+AnalogInputs::ValueType AnalogInputs::calibrateValue(Name name, ValueType x)
+{
+    if (x == 0) return 0;
+    const CalibrationTable &t = calibrationTable_[name];
+
+    //binary search: last segment starting at or below x
+    uint8_t k = 0, hi = t.segments - 1;
+    while(k < hi) {
+        uint8_t mid = (k + hi + 1) >> 1;
+        if(t.p[mid].x <= x) k = mid;
+        else hi = mid - 1;
+    }
+
+    const CalibrationPoint &p0 = t.p[k + ((t.anchor >> k) & 1)];
+    return calibrate(t.valueM[k], t.valueShift[k], p0.x, p0.y, x);
+}
+
 AnalogInputs::ValueType AnalogInputs::reverseCalibrateValue(Name name, ValueType y)
 {
     if (y == 0) return 0;
-    //TODO: do this with more points
-    CalibrationPoint p0, p1;
-    getCalibrationPoint(p0, name, 0);
-    getCalibrationPoint(p1, name, 1);
-    int32_t x,a;
-    x  = p1.x; x -= p0.x;
-    a  =  y;   a -= p0.y;
-    x *= a;
-    a  = p1.y; a -= p0.y;
-    x /= a;
-    x += p0.x;
+    const CalibrationTable &t = calibrationTable_[name];
+
+    //y is monotonic in x, but may be decreasing (thermistor)
+    bool decreasing = t.p[t.segments].y < t.p[0].y;
+    uint8_t k = 0, hi = t.segments - 1;
+    while(k < hi) {
+        uint8_t mid = (k + hi + 1) >> 1;
+        if((t.p[mid].y <= y) != decreasing) k = mid;
+        else hi = mid - 1;
+    }
 
-    if(x < 0) x = 0;
-    if(x > UINT16_MAX) x = UINT16_MAX;
-    return x;
+    const CalibrationPoint &p0 = t.p[k + ((t.anchor >> k) & 1)];
+    return calibrate(t.reverseM[k], t.reverseShift[k], p0.y, p0.x, y);
 }
 
 
@@ -376,6 +760,78 @@ void AnalogInputs::printRealValue(Name name, uint8_t dig)
     lcdPrintAnalog(x, dig, t);
 }
 
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+
+//the accumulators are written only in the ADC interrupt,
+//read until two reads agree instead of disabling interrupts
+static uint64_t readAccumulator(volatile uint64_t &accumulator)
+{
+    uint64_t v;
+    do {
+        v = accumulator;
+    } while(v != accumulator);
+    return v;
+}
+
+AnalogInputs::ValueType AnalogInputs::getCharge()
+{
+    //check units
+    STATIC_ASSERT(ANALOG_AMP(1.0) == ANALOG_CHARGE(1.0));
+
+    return readAccumulator(i_charge_) / ANALOG_INPUTS_TICKS_PER_HOUR;
+}
+
+AnalogInputs::ValueType AnalogInputs::getEout()
+{
+    const uint64_t divider = ANALOG_INPUTS_TICKS_PER_HOUR
+            * (uint32_t(ANALOG_AMP(1.0)) * ANALOG_VOLT(1.0) / ANALOG_WATTH(1.0));
+    return readAccumulator(i_Eout_) / divider;
+}
+
+void AnalogInputs::doSlowInterrupt() {}
+
+//the mean of all samples of the round, in getAvrADCValue() units
+static AnalogInputs::ValueType getRoundValue(AnalogInputs::Name name)
+{
+    uint32_t adc = AnalogInputs::i_roundSum_[name] / ANALOG_INPUTS_ADC_BURST_COUNT;
+    if(adc > UINT16_MAX) adc = UINT16_MAX;
+    return adc;
+}
+
+void AnalogInputs::intterruptIntegrate()
+{
+    STATIC_ASSERT(Vout_plus_pin < Idischarge && Vout_minus_pin < Idischarge && Ismps < Idischarge);
+
+    uint16_t time = Time::getInterruptsU16();
+    uint16_t dt = time - i_integrateTime_;
+    i_integrateTime_ = time;
+
+    Name name = Idischarge;
+    bool on = Discharger::isPowerOn();
+    if(!on && SMPS::isPowerOn()) {
+        name = Ismps;
+        on = true;
+    }
+    if(on) {
+        uint32_t I = calibrateValue(name, getRoundValue(name));
+
+        //voltage from the same round
+        ValueType out_p = calibrateValue(Vout_plus_pin, getRoundValue(Vout_plus_pin));
+        ValueType out_m = calibrateValue(Vout_minus_pin, getRoundValue(Vout_minus_pin));
+        uint32_t P = 0;
+        if(out_m < out_p)
+            P = I * (out_p - out_m);
+
+        i_charge_ += I * dt;
+        i_Eout_ += uint64_t(P) * dt;
+    }
+    for(uint8_t i = 0; i <= Idischarge; i++) {
+        i_roundSum_[i] = 0;
+    }
+}
+
+#else //ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+
 static inline uint32_t toHoursBasis(uint32_t accumulator) {
     uint32_t retu = accumulator;
     retu /= 1000000/TIMER_INTERRUPT_PERIOD_MICROSECONDS
@@ -389,9 +845,7 @@ AnalogInputs::ValueType AnalogInputs::getCharge()
     STATIC_ASSERT(ANALOG_AMP(1.0) == ANALOG_CHARGE(1.0));
 
     uint32_t retu;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        retu = i_charge_;
-    }
+    READ_ATOMIC(retu, i_charge_)
     return toHoursBasis(retu);
 }
 
@@ -399,9 +853,7 @@ AnalogInputs::ValueType AnalogInputs::getCharge()
 AnalogInputs::ValueType AnalogInputs::getEout()
 {
     uint32_t retu;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        retu = i_Eout_;
-    }
+    READ_ATOMIC(retu, i_Eout_)
 
     //check units
     STATIC_ASSERT(uint32_t(ANALOG_AMP(1.0))*ANALOG_VOLT(1.0)
@@ -414,18 +866,21 @@ AnalogInputs::ValueType AnalogInputs::getEout()
 
 void AnalogInputs::doSlowInterrupt()
 {
-    i_charge_ += getIout();
+    ValueType I = getFrameValue(Iout);
+    i_charge_ += I;
 
     if(--i_Eout_dt_ == 0) {
         i_Eout_dt_ = ANALOG_INPUTS_E_OUT_dt_FACTOR;
 
-        uint32_t P = getIout();
-        P *= getVout();
+        uint32_t P = I;
+        P *= getFrameValue(Vout);
         uint32_t E_since_previous_measurement = P / ANALOG_INPUTS_E_OUT_DIVIDER;
         i_Eout_ += E_since_previous_measurement;
     }
 }
 
+#endif //ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+
 // finalize Measurement
 
 void AnalogInputs::intterruptFinalizeMeasurement()
@@ -440,6 +895,43 @@ void AnalogInputs::doIdle()
     finalizeFullMeasurement();
 }
 
+#if ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS > 1
+
+//returns true when a full measurement (all blocks) has been replaced
+static bool pushWindowBlock()
+{
+    using namespace AnalogInputs;
+    ANALOG_INPUTS_FOR_ALL_PHY(name) {
+        windowAvr_[windowIndex_][name] = i_avrSum_[name] / ANALOG_INPUTS_ADC_BLOCK_MEASUREMENTS_COUNT;
+    }
+    if(windowFill_ < ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS)
+        windowFill_++;
+    if(++windowIndex_ < ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS)
+        return false;
+    windowIndex_ = 0;
+    return true;
+}
+
+static AnalogInputs::ValueType getWindowAvr(AnalogInputs::Name name)
+{
+    using namespace AnalogInputs;
+    //after resetMeasurement() the window fills up from windowAvr_[0]
+    uint32_t sum = 0;
+    for(uint8_t i = 0; i < windowFill_; i++) {
+        sum += windowAvr_[i][name];
+    }
+    return sum / windowFill_;
+}
+
+void AnalogInputs::setRealBasedOnAvr(AnalogInputs::Name name)
+{
+    avrAdc_[name] = getWindowAvr(name);
+    ValueType real = calibrateValue(name, avrAdc_[name]);
+    setReal(name, real);
+}
+
+#else
+
 void AnalogInputs::setRealBasedOnAvr(AnalogInputs::Name name)
 {
     avrAdc_[name] = i_avrSum_[name] / ANALOG_INPUTS_ADC_MEASUREMENTS_COUNT;
@@ -447,93 +939,161 @@ void AnalogInputs::setRealBasedOnAvr(AnalogInputs::Name name)
     setReal(name, real);
 }
 
+#endif
+
 void AnalogInputs::finalizeFullMeasurement()
 {
     uint16_t avrCount;
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        avrCount = i_avrCount_;
-    }
+    READ_ATOMIC(avrCount, i_avrCount_)
 
     if(avrCount == 0) {
         if(!ignoreLastResult_) {
+#if ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS > 1
+            //stableCount_ and calculationCount_ still count full measurements
+            bool full = pushWindowBlock();
+            updateStable_ = full;
+#endif
             if(isPowerOn()) {
+#if ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS > 1
+                measurementCount_++;
+                if(full) calculationCount_++;
+#else
                 calculationCount_++;
-
-                i_deltaAvrSumVoutPlus_    += i_avrSum_[Vout_plus_pin] >> ANALOG_INPUTS_ADC_DELTA_SHIFT;
-                i_deltaAvrSumVoutMinus_   += i_avrSum_[Vout_minus_pin] >> ANALOG_INPUTS_ADC_DELTA_SHIFT;
-                i_deltaAvrSumTextern_     += i_avrSum_[Textern] >> ANALOG_INPUTS_ADC_DELTA_SHIFT;
-                i_deltaAvrCount_ ++;
-                finalizeDeltaMeasurement();
+#endif
 
                 ANALOG_INPUTS_FOR_ALL_PHY(name) {
                     setRealBasedOnAvr(name);
                 }
                 finalizeFullVirtualMeasurement();
+                finalizeDeltaMeasurement();
             } else {
                 //we need internal temperature all the time to control the fan
                 if(onTintern_) {
                     setRealBasedOnAvr(AnalogInputs::Tintern);
                 }
             }
+#if ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS > 1
+            updateStable_ = true;
+#endif
+            publishFrame();
         }
         _resetAvr();
     }
 }
 
 
-void AnalogInputs::finalizeDeltaMeasurement()
+static void resetDeltaEstimator(AnalogInputs::DeltaEstimator &e, AnalogInputs::ValueType y)
 {
-    if(Time::diffU16(deltaStartTimeU16_, Time::getMilisecondsU16()) > ANALOG_INPUTS_DELTA_TIME_MILISECONDS) {
-        uint32_t deltaAvrCount;
-        uint32_t deltaAvrSumVoutPlus;
-        uint32_t deltaAvrSumVoutMinus;
-        uint32_t deltaAvrSumTextern;
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-            deltaAvrCount = i_deltaAvrCount_;
-            deltaAvrCount *= ANALOG_INPUTS_ADC_MEASUREMENTS_COUNT;
-            deltaAvrCount >>= ANALOG_INPUTS_ADC_DELTA_SHIFT;
-            deltaAvrSumVoutPlus  = i_deltaAvrSumVoutPlus_;
-            deltaAvrSumVoutMinus = i_deltaAvrSumVoutMinus_;
-            deltaAvrSumTextern   = i_deltaAvrSumTextern_;
-        }
-        _resetDeltaAvr();
-        deltaCount_++;
+    e.s1 = int32_t(y) << ANALOG_INPUTS_DELTA_FRACTION_BITS;
+    e.s2 = e.s1;
+}
 
-        uint16_t x;
-        ValueType real, old, VoutPlus, VoutMinus;
+//s1 = EMA(y), s2 = EMA(s1), alpha = 1/m
+static void updateDeltaEstimator(AnalogInputs::DeltaEstimator &e, AnalogInputs::ValueType y, uint16_t m)
+{
+    int32_t x = int32_t(y) << ANALOG_INPUTS_DELTA_FRACTION_BITS;
+    e.s1 += (x - e.s1) / m;
+    e.s2 += (e.s1 - e.s2) / m;
+}
+
+//fitted value at the last sample: 2*s1 - s2
+static AnalogInputs::ValueType getDeltaLevel(const AnalogInputs::DeltaEstimator &e)
+{
+    int32_t a = 2 * e.s1 - e.s2;
+    a += 1 << (ANALOG_INPUTS_DELTA_FRACTION_BITS - 1);
+    a >>= ANALOG_INPUTS_DELTA_FRACTION_BITS;
+    if(a < 0) a = 0;
+    if(a > UINT16_MAX) a = UINT16_MAX;
+    return a;
+}
+
+//smoothed value: s1, lags behind the fitted one but has less noise
+static AnalogInputs::ValueType getDeltaMean(const AnalogInputs::DeltaEstimator &e)
+{
+    int32_t a = e.s1;
+    a += 1 << (ANALOG_INPUTS_DELTA_FRACTION_BITS - 1);
+    a >>= ANALOG_INPUTS_DELTA_FRACTION_BITS;
+    if(a < 0) a = 0;
+    if(a > UINT16_MAX) a = UINT16_MAX;
+    return a;
+}
 
-        //calculate deltaVout
-        deltaAvrSumVoutPlus /= deltaAvrCount;
-        deltaAvrSumVoutMinus /= deltaAvrCount;
+//slope per minute: (s1 - s2) * alpha / (1 - alpha) per sample
+static int16_t getDeltaSlope(const AnalogInputs::DeltaEstimator &e, uint16_t m, uint16_t period)
+{
+    int32_t b = (e.s1 - e.s2) / (m - 1);
+    //keep b * 60000 in 32 bits
+    if(b > INT16_MAX) b = INT16_MAX;
+    if(b < -INT16_MAX) b = -INT16_MAX;
+    b *= 60000;
+    b /= period;
+    b >>= ANALOG_INPUTS_DELTA_FRACTION_BITS;
+    if(b > INT16_MAX) b = INT16_MAX;
+    if(b < -INT16_MAX) b = -INT16_MAX;
+    return b;
+}
 
+uint16_t AnalogInputs::getDeltaCountsPerMinute()
+{
+    if(deltaPeriod_ == 0)
+        return 0;
+    return 60000 / deltaPeriod_;
+}
+
+uint16_t AnalogInputs::getDeltaWindowCount()
+{
+    if(deltaPeriod_ == 0)
+        return UINT16_MAX;
+    return deltaWindow_ / deltaPeriod_;
+}
 
-        VoutPlus  = calibrateValue(Vout_plus_pin,  deltaAvrSumVoutPlus);
-        VoutMinus = calibrateValue(Vout_minus_pin, deltaAvrSumVoutMinus);
-        real = 0;
-        if(VoutPlus > VoutMinus)
-            real = VoutPlus - VoutMinus;
+void AnalogInputs::finalizeDeltaMeasurement()
+{
+    ValueType out = getRealValue(Vout);
+    ValueType T = getRealValue(Textern);
+    uint16_t time = Time::getMilisecondsU16();
 
-        old = getRealValue(deltaVoutMax);
-        if(real >= old || (!enable_deltaVoutMax_)) {
-            setReal(deltaVoutMax, real);
+    if(deltaCount_ == 0) {
+        resetDeltaEstimator(deltaVoutEstimator_, out);
+        resetDeltaEstimator(deltaTexternEstimator_, T);
+    } else {
+        //the sample period is kept between charges
+        int16_t dt = Time::diffU16(deltaLastTimeU16_, time);
+        if(deltaPeriod_ == 0) {
+            deltaPeriod_ = dt;
+        } else {
+            dt -= deltaPeriod_;
+            deltaPeriod_ += dt / 8;
         }
-        setReal(deltaVout, real - old);
+    }
+    deltaLastTimeU16_ = time;
+    if(deltaCount_ < UINT16_MAX)
+        deltaCount_++;
 
-        //calculate deltaTextern
-        uint16_t dc = 2;
-#if ANALOG_INPUTS_DELTA_TIME_MILISECONDS != 30000
-#error "ANALOG_INPUTS_DELTA_TIME_MILISECONDS != 30000"
-#endif
-        deltaAvrSumTextern /= deltaAvrCount;
-        x = deltaAvrSumTextern;
-        real = calibrateValue(Textern, x);
-        old = deltaLastT_;
-        deltaLastT_ = real;
-        real -= old;
-        real *= dc;
-        setReal(deltaTextern, real);
-        setReal(deltaLastCount, deltaAvrCount);
+    if(deltaPeriod_ == 0)
+        return;
+
+    //a window of n samples has the same mean lag as an EMA with alpha = 2/(n+1)
+    uint16_t m = (getDeltaWindowCount() + 1) / 2;
+    if(m < 2) m = 2;
+
+    updateDeltaEstimator(deltaVoutEstimator_, out, m);
+    updateDeltaEstimator(deltaTexternEstimator_, T, m);
+
+    //calculate deltaVout: the drop from the maximum, both smoothed
+    //(the fitted level would let the noise trip the -dV termination)
+    ValueType real, old;
+    real = getDeltaMean(deltaVoutEstimator_);
+    old = getRealValue(deltaVoutMax);
+    if(real >= old || (!enable_deltaVoutMax_)) {
+        setReal(deltaVoutMax, real);
     }
+    setReal(deltaVout, real - old);
+
+    //calculate deltaTextern
+    deltaLastT_ = getDeltaLevel(deltaTexternEstimator_);
+    setReal(deltaTextern, getDeltaSlope(deltaTexternEstimator_, m, deltaPeriod_));
+    setReal(deltaLastCount, m);
 }
 
 void AnalogInputs::finalizeFullVirtualMeasurement()
@@ -596,23 +1156,20 @@ void AnalogInputs::finalizeFullVirtualMeasurement()
         IoutValue = getRealValue(Ismps);
     }
 
-    uint32_t P = IoutValue;
-    P *= out;
-    P /= 10000;
-    setReal(Pout, P);
-
     setReal(Iout, IoutValue);
-    setReal(Cout, getCharge());
-    setReal(Eout, getEout());
+    //Pout, Cout, Eout
+    lazyDirty_ = (1 << (Eout - Pout + 1)) - 1;
 }
 
 void AnalogInputs::setReal(Name name, ValueType real)
 {
-    if(absDiff(real_[name], real) > STABLE_VALUE_ERROR)
-        stableCount_[name] = 0;
-    else
-        stableCount_[name]++;
+#if ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS > 1
+    if(updateStable_)
+#endif
+        updateStable(name, real);
 
+    if(name >= Pout && name <= Eout)
+        lazyDirty_ &= ~(1 << (name - Pout));
     real_[name] = real;
 }
 
@@ -22,8 +22,19 @@
 #include "HardwareConfig.h"
 #include "cpu/config.h"
 
+//can be increased in GlobalConfig.h
+#ifndef ANALOG_INPUTS_MAX_CALIBRATION_POINTS
 #define ANALOG_INPUTS_MAX_CALIBRATION_POINTS    2
-#define ANALOG_INPUTS_DELTA_TIME_MILISECONDS    30000
+#endif
+//can be increased in GlobalConfig.h
+#ifndef ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS
+#define ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS     1
+#endif
+//getADCValue(Ismps) * scale is in getAvrADCValue(Ismps) units
+#ifndef ANALOG_INPUTS_ADC_SCALE_Ismps
+#define ANALOG_INPUTS_ADC_SCALE_Ismps           1
+#endif
+#define ANALOG_INPUTS_DELTA_TIME_MILISECONDS    30000 // default window of deltaVout, deltaTextern
 #define ANALOG_INPUTS_RESOLUTION                12  // bits
 
 #define ANALOG_INPUTS_MAX_ADC_VALUE      (((1<<(ANALOG_INPUTS_ADC_RESOLUTION_BITS))-1) << ((ANALOG_INPUTS_RESOLUTION) - (ANALOG_INPUTS_ADC_RESOLUTION_BITS)))
@@ -38,6 +49,10 @@ namespace AnalogInputs {
         ValueType y;
     } CHEALI_EEPROM_PACKED;
 
+    //calibration points above p1 are optional
+    static const ValueType CALIBRATION_POINT_UNUSED = 0xffff;
+    inline bool isCalibrationPointUsed(const CalibrationPoint &p) { return p.x != CALIBRATION_POINT_UNUSED; }
+
     struct DefaultValues {
         CalibrationPoint p0;
         CalibrationPoint p1;
@@ -107,9 +122,22 @@ namespace AnalogInputs {
     };
     static const uint8_t    PHYSICAL_INPUTS     = VirtualInputs - Vout_plus_pin;
     static const uint8_t    ALL_INPUTS          = LastInput - Vout_plus_pin;
+
+    //real values of one measurement
+    struct Frame {
+        uint16_t count;     //getFullMeasurementCount()
+        ValueType real[ALL_INPUTS];
+    };
     static const ValueType  REVERSE_POLARITY_MIN_VOLTAGE = ANALOG_VOLT(1.000);
     static const ValueType  CONNECTED_MIN_VOLTAGE = ANALOG_VOLT(0.400);
 
+    //copy of the last completed measurement, doesn't disable interrupts
+    //(main loop only: calculates Pout, Cout, Eout)
+    void getFrame(Frame &frame);
+    //value of the last completed measurement, can be used in interrupts
+    //(except Pout, Cout, Eout)
+    ValueType getFrameValue(Name name);
+
     //get the average ADC value
     ValueType getAvrADCValue(Name name);
     //get real value (usable) - average, after calibration
@@ -123,7 +151,13 @@ namespace AnalogInputs {
     ValueType getVout();
     ValueType getIout();
     ValueType getDeltaLastT();
+    //number of full measurements used by the delta estimator
     ValueType getDeltaCount();
+    uint16_t getDeltaCountsPerMinute();
+    //number of full measurements in the delta window
+    uint16_t getDeltaWindowCount();
+    //deltaVout/deltaTextern window, default: ANALOG_INPUTS_DELTA_TIME_MILISECONDS
+    void setDeltaWindow(uint16_t miliseconds);
     ValueType getCharge();
     ValueType getEout();
     void enableDeltaVoutMax(bool enable);
@@ -133,7 +167,11 @@ namespace AnalogInputs {
     void saveBalancePortState();
 
     uint16_t getFullMeasurementCount();
+    //incremented after every block of a full measurement (see ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS)
+    uint16_t getMeasurementCount();
     uint16_t getStableCount(Name name);
+    //standard deviation of the input, only for VoutBalancer, Iout and Vb1..
+    ValueType getNoise(Name name);
 
     Type getType(Name name);
 
@@ -154,6 +192,7 @@ namespace AnalogInputs {
 
 //calibration
     void restoreDefault();
+    void loadCalibration();
 
     ValueType calibrateValue(Name name, ValueType x);
     ValueType reverseCalibrateValue(Name name, ValueType y);
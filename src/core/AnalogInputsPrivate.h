@@ -34,6 +34,14 @@ namespace AnalogInputs {
     extern volatile bool onTintern_;
 
     void intterruptFinalizeMeasurement();
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+    //Vout_plus_pin, Vout_minus_pin, Ismps, Idischarge: the burst sums of the round
+    //(like i_avrSum_), added by the ADC driver after every burst
+    extern volatile uint32_t  i_roundSum_[Idischarge + 1];
+    //called by the ADC driver after every round, with i_roundSum_ normalized to
+    //scale_ * ANALOG_INPUTS_ADC_BURST_COUNT samples: integrates charge and energy
+    void intterruptIntegrate();
+#endif
     void resetStable();
 
     void doIdle();
@@ -43,6 +51,51 @@ namespace AnalogInputs {
     void getCalibrationPoint(CalibrationPoint &p, Name name, uint8_t i);
     void setCalibrationPoint(Name name, uint8_t i, const CalibrationPoint &p);
 
+    //RAM copy of the calibration, rebuilt by setCalibrationPoint()
+    //segment k: y = y0 +/- (|x - x0| * m[k]) >> shift[k]
+    //where (x0, y0) is p[k] or p[k+1] (see anchor)
+    #define ANALOG_INPUTS_CALIBRATION_SEGMENTS  (ANALOG_INPUTS_MAX_CALIBRATION_POINTS - 1)
+    #define ANALOG_INPUTS_CALIBRATION_NEGATIVE  0x80
+
+    struct CalibrationTable {
+        CalibrationPoint p[ANALOG_INPUTS_MAX_CALIBRATION_POINTS]; //sorted by x
+        uint32_t valueM[ANALOG_INPUTS_CALIBRATION_SEGMENTS];       //calibrateValue
+        uint32_t reverseM[ANALOG_INPUTS_CALIBRATION_SEGMENTS];     //reverseCalibrateValue
+        uint8_t valueShift[ANALOG_INPUTS_CALIBRATION_SEGMENTS];
+        uint8_t reverseShift[ANALOG_INPUTS_CALIBRATION_SEGMENTS];
+        uint8_t segments;
+        //bit k set: segment k is anchored at p[k+1] (the point saved first)
+        uint8_t anchor;
+    };
+
+    extern CalibrationTable calibrationTable_[PHYSICAL_INPUTS];
+    void updateCalibrationTable(Name name);
+
+    //Welford mean/variance, fixed point with ANALOG_INPUTS_STABLE_FRACTION_BITS
+    //kept only for the inputs used by isOutStable() and Balancer::isStable()
+    #define ANALOG_INPUTS_STABLE_INPUTS         (MAX_BALANCE_CELLS + 2)
+    #define ANALOG_INPUTS_STABLE_FRACTION_BITS  4
+
+    struct StableStat {
+        int32_t mean;
+        uint32_t m2;        //sum of squared deviations
+        uint16_t count;     //samples in the current run
+        uint8_t n;          //samples in mean/m2, up to STABLE_WINDOW
+        int8_t outlier;     //side of the last sample outside the band
+    };
+
+    extern StableStat stable_[ANALOG_INPUTS_STABLE_INPUTS];
+    void updateStable(Name name, ValueType real);
+
+    //discounted least squares line fit (double exponential smoothing),
+    //fixed point with ANALOG_INPUTS_DELTA_FRACTION_BITS
+    #define ANALOG_INPUTS_DELTA_FRACTION_BITS   8
+
+    struct DeltaEstimator {
+        int32_t s1;
+        int32_t s2;
+    };
+
 
 };
 
@@ -53,8 +53,17 @@ namespace AnalogInputs {
         Unknown
     };
 
+    //stability detector: running mean/variance of consecutive full measurements
+    //a sample further than max(STABLE_VALUE_ERROR, STABLE_BAND_SIGMA * noise)
+    //from the mean starts a new run, the input is stable when the run is at least
+    //STABLE_MIN_VALUE long and the mean is known within +/- STABLE_VALUE_ERROR/2
+    //Iout: the error is at least 1/STABLE_IOUT_RELATIVE of the current
     static const ValueType  STABLE_VALUE_ERROR  = 6;
+    static const uint8_t    STABLE_IOUT_RELATIVE = 100;
     static const uint16_t   STABLE_MIN_VALUE    = 3;
+    static const uint8_t    STABLE_BAND_SIGMA   = 3;
+    //samples in the variance estimate, older samples decay exponentially
+    static const uint8_t    STABLE_WINDOW       = 32;
 
     AnalogInputs::ValueType evalI(AnalogInputs::ValueType P, AnalogInputs::ValueType U);
 };
@@ -39,6 +39,8 @@ void setup()
     hardware::initializePins();
     cpu::init();
 
+    //hardware::initialize() already needs the calibration
+    AnalogInputs::loadCalibration();
     hardware::initialize();
     Time::initialize();
     SMPS::initialize();
@@ -36,6 +36,20 @@
 #define ENABLE_CALIBRATION
 #define ENABLE_CALIBRATION_CHECK
 
+/*
+ * piecewise linear calibration, more than 2 points per input
+ * (every additional point costs 14 bytes of RAM per input)
+ */
+//#define ANALOG_INPUTS_MAX_CALIBRATION_POINTS    4
+
+/*
+ * sliding window averaging: a full measurement is split into blocks,
+ * new values are published after every block (the averaging depth stays the same)
+ * ANALOG_INPUTS_ADC_ROUND_MAX_COUNT must be a multiple of it,
+ * costs 2 bytes of RAM per physical input and block
+ */
+//#define ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS     5
+
 /*
  * (experimental and dangerous)
  * maximum charge current will be determined
@@ -46,7 +60,7 @@
 #define STRINGS_HEADER "strings/standard.h"
 
 #define CHEALI_CHARGER_ARCHITECTURE                     (CHEALI_CHARGER_ARCHITECTURE_CPU + CHEALI_CHARGER_ARCHITECTURE_GENERIC)
-#define CHEALI_CHARGER_ARCHITECTURE_INFO                (MAX_BALANCE_CELLS)
+#define CHEALI_CHARGER_ARCHITECTURE_INFO                (MAX_BALANCE_CELLS + ((ANALOG_INPUTS_MAX_CALIBRATION_POINTS - 2) << 8))
 
 #define DISCHARGE_OUTPUT_CAPACITOR_CURRENT              ANALOG_AMP(1.0)
 
@@ -203,7 +203,7 @@ BALANCER_PORTS_GT_6(
 )
 {string_v_menu_cellSum,     COND_NOT_EDITABLE,  EANALOG_V(Vbalancer),   {0, 0, 0}},
 {string_v_menu_output,      COND_NOT_EDITABLE,  EANALOG_V(Vout),        {0, 0, 0}},
-{string_menu_point,         COND_POINT,         {CP_TYPE_UNSIGNED, 0, &calibrationPoint},        {1, 0, 1}},
+{string_menu_point,         COND_POINT,         {CP_TYPE_UNSIGNED, 0, &calibrationPoint},        {1, 0, ANALOG_INPUTS_MAX_CALIBRATION_POINTS - 1}},
 {NULL,                      EDIT_MENU_LAST}
 };
 
@@ -232,7 +232,7 @@ const EditMenu::StaticEditData editExpertVoltageData[] PROGMEM = {
 #endif //ENABLE_SIMPLIFIED_VB0_VB2_CIRCUIT
 {string_ev_menu_plusVoltagePin,     COND_EDITABLE,   EANALOG_V(Vout_plus_pin),   {CE_STEP_TYPE_KEY_SPEED, 0, MAX_CHARGE_V}},
 {string_ev_menu_minusVoltagePin,    COND_EDITABLE,   EANALOG_V(Vout_minus_pin),  {CE_STEP_TYPE_KEY_SPEED, 0, MAX_CHARGE_V}},
-{string_menu_point,                 COND_POINT,     {CP_TYPE_UNSIGNED, 0, &calibrationPoint},        {1, 0, 1}},
+{string_menu_point,                 COND_POINT,     {CP_TYPE_UNSIGNED, 0, &calibrationPoint},        {1, 0, ANALOG_INPUTS_MAX_CALIBRATION_POINTS - 1}},
 {NULL,                              EDIT_MENU_LAST}
 };
 
@@ -267,7 +267,7 @@ void expertVoltageCalibration()
 const EditMenu::StaticEditData editExternTData[] PROGMEM = {
 {string_t_menu_temperature,     COND_EDITABLE,      EANALOG_T(Textern),             {CE_STEP_TYPE_KEY_SPEED, 0, ANALOG_CELCIUS(100)}},
 {string_t_menu_adc,             COND_NOT_EDITABLE,  EANALOG_ADC(Textern),           {0,0,0}},
-{string_menu_point,             COND_POINT,         {CP_TYPE_UNSIGNED, 0, &calibrationPoint},        {1, 0, 1}},
+{string_menu_point,             COND_POINT,         {CP_TYPE_UNSIGNED, 0, &calibrationPoint},        {1, 0, ANALOG_INPUTS_MAX_CALIBRATION_POINTS - 1}},
 {NULL,                          EDIT_MENU_LAST}
 };
 
@@ -294,7 +294,7 @@ void externalTemperatureCalibration()
 const EditMenu::StaticEditData editInternTData[] PROGMEM = {
 {string_t_menu_temperature,     COND_EDITABLE,      EANALOG_T(Tintern),             {CE_STEP_TYPE_KEY_SPEED, 0, ANALOG_CELCIUS(100)}},
 {string_t_menu_adc,             COND_NOT_EDITABLE,  EANALOG_ADC(Tintern),           {0,0,0}},
-{string_menu_point,             COND_POINT,         {CP_TYPE_UNSIGNED, 0, &calibrationPoint},        {1, 0, 1}},
+{string_menu_point,             COND_POINT,         {CP_TYPE_UNSIGNED, 0, &calibrationPoint},        {1, 0, ANALOG_INPUTS_MAX_CALIBRATION_POINTS - 1}},
 {NULL,                          EDIT_MENU_LAST}
 };
 
@@ -117,6 +117,9 @@ static void currentCalibration(uint8_t point)
 
         getCalibrationPoint(pSet, gNameSet_, point);
         getCalibrationPoint(p, gName_, point);
+        if(!AnalogInputs::isCalibrationPointUsed(pSet)) {
+            pSet.x = pSet.y = 0;
+        }
 
         EditMenu::initialize(currentData, editCallback);
         gIexpected_ = pSet.y;
@@ -157,6 +160,9 @@ static void currentCalibration(uint8_t point)
 static void printCurrentPointItem(uint8_t index) {
     AnalogInputs::CalibrationPoint pSet;
     AnalogInputs::getCalibrationPoint(pSet, gName_, index);
+    if(!AnalogInputs::isCalibrationPointUsed(pSet)) {
+        pSet.y = 0;
+    }
     lcdPrintCurrent(pSet.y, 7);
 }
 
@@ -164,7 +170,7 @@ static void currentCalibrationPointMenu()
 {
     int8_t index = 0;
     do {
-        Menu::initialize(2);
+        Menu::initialize(ANALOG_INPUTS_MAX_CALIBRATION_POINTS);
         Menu::printMethod_ = printCurrentPointItem;
         Menu::setIndex(index);
         index = Menu::run();
@@ -21,4 +21,21 @@ include(${CORE_DIR}/drivers/drivers.cmake)
 include(${CORE_DIR}/strings/strings.cmake)
 include(${CORE_DIR}/helper/helper.cmake)
 
+#flash/RAM/stack footprint of the built targets (see footprint.sh):
+#  make footprint  ->  footprint/<target>.footprint
+#the stack part needs the .su files: CHEALI_STACK_USAGE=ON
+option(CHEALI_STACK_USAGE "compile with -fstack-usage (the stack in make footprint)" OFF)
+if(CHEALI_STACK_USAGE)
+    add_compile_options(-fstack-usage)
+endif()
+
+if(NOT TARGET footprint)
+    add_custom_target(footprint
+        COMMAND bash -c "bash ${CORE_DIR}/footprint.sh footprint $(find . -name '*.elf' -not -path './footprint/*')"
+        WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+        COMMENT "flash/RAM/stack footprint: ${CMAKE_BINARY_DIR}/footprint"
+        VERBATIM
+    )
+endif()
+
 
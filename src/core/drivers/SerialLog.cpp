@@ -66,6 +66,7 @@ namespace SerialLog {
 
 
 void sendTime();
+void sendHeader(uint16_t channel);
 
 #ifdef ENABLE_SERIAL_LOG
 
@@ -114,10 +115,10 @@ void powerOff()
     state = Off;
 }
 
-void send()
+bool updateTime()
 {
     if(state == Off)
-        return;
+        return false;
 
     currentTime = Time::getMiliseconds();
 
@@ -127,7 +128,21 @@ void send()
     }
 
     currentTime -= startTime;
-    sendTime();
+    return true;
+}
+
+void send()
+{
+    if(updateTime())
+        sendTime();
+}
+
+bool beginChannel(uint16_t channel)
+{
+    if(!updateTime())
+        return false;
+    sendHeader(channel);
+    return true;
 }
 
 void flush()
@@ -162,6 +177,7 @@ void printChar(char c){}
 void powerOn(){}
 void powerOff(){}
 void send(){}
+bool beginChannel(uint16_t channel){ return false; }
 void doIdle(){}
 void flush(){}
 
@@ -238,10 +254,12 @@ void sendEnd()
 void sendChannel1()
 {
     sendHeader(1);
-    //analog inputs
+    //analog inputs, all from the same measurement
+    AnalogInputs::Frame frame;
+    AnalogInputs::getFrame(frame);
     for(uint8_t i=0;i < sizeOfArray(channel1);i++) {
         AnalogInputs::Name name = pgm::read(&channel1[i]);
-        uint16_t v = AnalogInputs::getRealValue(name);
+        uint16_t v = frame.real[name];
         printUInt(v);
         printD();
     }
@@ -24,6 +24,12 @@ namespace SerialLog {
     void powerOff();
     void flush();
 
+    //a line of another module: beginChannel(), the values (print...(), printD()),
+    //sendEnd() - the checksum; false: the log is off
+    bool beginChannel(uint16_t channel);
+    void printD();
+    void sendEnd();
+
     void printString(const char *s);
     void printString_P(const char *s);
     void printLong(int32_t x);
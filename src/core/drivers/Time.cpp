@@ -23,6 +23,9 @@
 #include "SerialLog.h"
 #include "AnalogInputsPrivate.h"
 #include "atomic.h"
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+#include "AnalogInputsNoise.h"
+#endif
 
 //#define ENABLE_DEBUG
 #include "debug.h"
@@ -44,11 +47,21 @@ namespace Time {
         interrupts_++;
     }
 
+    //nothing to do until the next interrupt
+    inline void waitForInterrupt() {
+#ifdef ENABLE_TIME_WAIT_FOR_INTERRUPT
+        hardware::waitForInterrupt();
+#endif
+    }
+
     void doIdle() {
         Monitor::doIdle();
         SerialLog::doIdle();
         Buzzer::doIdle();
         AnalogInputs::doIdle();
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+        AnalogInputsNoise::doIdle();
+#endif
     }
 
     void callback() {
@@ -101,7 +114,9 @@ void Time::delay(uint16_t ms)
 {
     uint16_t start = getMilisecondsU16();
 
-    while(diffU16(start, getMilisecondsU16()) < ms) {};
+    while(diffU16(start, getMilisecondsU16()) < ms) {
+        waitForInterrupt();
+    }
 }
 
 //warning: this method runs stuff in background,
@@ -110,10 +125,13 @@ void Time::delayDoIdle(uint16_t ms)
 {
     uint16_t start = getMilisecondsU16();
     uint16_t delay;
-    do {
+    while(true) {
         doIdle();
         delay = diffU16(start, getMilisecondsU16());
-    } while (delay < ms);
+        if(delay >= ms)
+            break;
+        waitForInterrupt();
+    }
 
     LogDebug("delayDoIdle ms:", ms, " delay:", delay);
 }
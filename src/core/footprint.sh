@@ -0,0 +1,229 @@
+#!/bin/bash
+#
+# flash/RAM/stack footprint of the firmware (one or more targets)
+#
+# usage: footprint.sh OUTPUT_DIR ELF...
+#  e.g. all targets of a build (compiled with -fstack-usage):
+#       footprint.sh footprint $(find build -name "*.elf")
+#  or in the build directory: make footprint (see core.cmake)
+#
+# writes OUTPUT_DIR/<target>.footprint: the section totals, the size of every
+# symbol and the static worst-case stack: the deepest call path of main()
+# plus the interrupt handlers on top of it:
+#  - AVR: the handlers are not nested (no ISR_NOBLOCK), the deepest one counts
+#  - Cortex-M: a handler is preempted only by a higher priority (lower
+#    number), the deepest handler of every priority level counts. The
+#    levels come from IRQ_PRIORITY (irq_priority.h) and the
+#    NVIC_SetPriority() calls next to it; without it every handler nests.
+# The stack of a function comes from the .su files (build with
+# -fstack-usage), the call graph from objdump. Indirect calls (function
+# pointers) and recursion are not followed, they are listed in the report.
+#
+# environment:
+#  SU_DIR           where the .su files are (default: the directory of the ELF)
+#  IRQ_PRIORITY     irq_priority.h of the cpu (Cortex-M)
+#  FLASH_BUDGET     bytes (default: atmega32 32768, Cortex-M0 (NUC029/M0517) 65536)
+#  RAM_BUDGET       bytes, data + bss + stack (default: 2048, 4096)
+#  TOOLCHAIN        binutils prefix (default: avr-, arm-none-eabi-)
+#
+# exit status: 1 if a target is over a budget
+
+OUTPUT_DIR="$1"
+shift
+if [ -z "$OUTPUT_DIR" -o $# -eq 0 ]; then
+    echo "usage: $0 OUTPUT_DIR ELF..."
+    exit 2
+fi
+mkdir -p "$OUTPUT_DIR"
+
+# priority of the handlers: "TMR0_IRQHandler 2"
+irq_priorities()
+{
+    local header="$1"
+    local dir="$(dirname "$(dirname "$header")")"
+    grep -rhoE "NVIC_SetPriority\( *[A-Za-z0-9_]+_IRQn *, *[A-Za-z0-9_]+ *\)" "$dir" --include=*.cpp --include=*.c \
+        | sed -E 's/NVIC_SetPriority\( *([A-Za-z0-9_]+)_IRQn *, *([A-Za-z0-9_]+) *\)/\1 \2/' \
+        | while read irq name; do
+            value=$(sed -nE "s/^#define +$name +([0-9]+).*/\1/p" "$header")
+            echo "${irq}_IRQHandler ${value:-0}"
+        done
+}
+
+# function stack usage: "name<TAB>bytes<TAB>static|dynamic"
+# the name without the return type and the parameters (overloads are merged)
+stack_usage()
+{
+    find "$1" -name "*.su" -exec cat {} + | awk -F'\t' '{
+        name = $1
+        sub(/^[^:]*:[0-9]+:[0-9]+:/, "", name)
+        p = index(name, "(")
+        if(p) name = substr(name, 1, p - 1)
+        n = split(name, w, " ")
+        name = w[n]
+        if(!(name in su) || su[name] < $2) { su[name] = $2; type[name] = $3 }
+    } END {
+        for(name in su) print name "\t" su[name] "\t" type[name]
+    }'
+}
+
+# call graph: "caller<TAB>callee", "caller<TAB>*" for an indirect call
+call_graph()
+{
+    "${BINUTILS}objdump" -d -C --no-show-raw-insn "$1" | awk -F'\t' '
+    function strip(name) {
+        gsub(/\(anonymous namespace\)/, "{anonymous}", name)
+        p = index(name, "(")
+        if(p) name = substr(name, 1, p - 1)
+        return name
+    }
+    /^[0-9a-f]+ <.*>:$/ {
+        f = $0
+        sub(/^[0-9a-f]+ </, "", f)
+        sub(/>:$/, "", f)
+        f = strip(f)
+        next
+    }
+    f != "" && NF >= 2 {
+        insn = $2
+        for(i = 3; i <= NF; i++) insn = insn " " $i
+        split(insn, w, " ")
+        op = w[1]
+        if(op ~ /^(call|callq|rcall|bl|blx|jmp|jmpq|rjmp|b|b\.n|b\.w)$/) {
+            if(match(insn, /<[^>]*>$/)) {
+                t = substr(insn, RSTART + 1, RLENGTH - 2)
+                if(t !~ /\+0x[0-9a-f]+$/) {
+                    t = strip(t)
+                    if(t != f) print f "\t" t
+                }
+            } else if(op != "jmp" || insn ~ /\*/) {
+                print f "\t*"
+            }
+        } else if(op ~ /^(icall|eicall|ijmp|eijmp)$/ || (op == "bx" && w[2] != "lr")) {
+            print f "\t*"
+        }
+    }' | sort -u
+}
+
+footprint()
+{
+    local elf="$1"
+    local target="$(basename "$elf")"
+    target="${target%.elf}"
+    local report="$OUTPUT_DIR/$target.footprint"
+
+    local machine="$(readelf -h "$elf" | sed -n 's/^ *Machine: *//p')"
+    # call_overhead: the return address pushed by a call,
+    # interrupt_frame: the registers pushed by the hardware
+    local toolchain flash_budget ram_budget call_overhead interrupt_frame nesting
+    case "$machine" in
+    *AVR*)  toolchain=avr-;           flash_budget=32768; ram_budget=2048; call_overhead=2; interrupt_frame=2;  nesting=none ;;
+    *ARM*)  toolchain=arm-none-eabi-; flash_budget=65536; ram_budget=4096; call_overhead=0; interrupt_frame=32; nesting=priority ;;
+    *)      toolchain=;               flash_budget=0;     ram_budget=0;    call_overhead=0; interrupt_frame=0;  nesting=none ;;
+    esac
+    BINUTILS="${TOOLCHAIN-$toolchain}"
+    flash_budget="${FLASH_BUDGET:-$flash_budget}"
+    ram_budget="${RAM_BUDGET:-$ram_budget}"
+
+    local tmp="$(mktemp -d)"
+    stack_usage "${SU_DIR:-$(dirname "$elf")}" > "$tmp/su"
+    call_graph "$elf" > "$tmp/calls"
+    if [ "$nesting" = priority -a -n "$IRQ_PRIORITY" ]; then
+        irq_priorities "$IRQ_PRIORITY" > "$tmp/priorities"
+    else
+        : > "$tmp/priorities"
+    fi
+    #defined (not weak) interrupt handlers
+    "${BINUTILS}nm" "$elf" | awk '$2 == "T" && ($3 ~ /^__vector_[0-9]+$/ || ($3 ~ /_Handler$|_IRQHandler$/ && $3 !~ /^(Reset|Default)_Handler$/)) {print $3}' > "$tmp/handlers"
+
+    {
+        echo "target: $target ($machine)"
+        echo
+        "${BINUTILS}size" -A "$elf" | awk -v flash_budget="$flash_budget" '
+            $1 ~ /^\.(text|rodata|vectors|init|fini|ARM)/ { flash += $2 }
+            $1 == ".data" { flash += $2; data += $2 }
+            $1 ~ /^\.(bss|noinit)/ { bss += $2 }
+            $1 == ".eeprom" { eeprom += $2 }
+            END {
+                printf "flash:  %6d", flash
+                if(flash_budget > 0) printf " / %d (%.1f%%)", flash_budget, 100.0 * flash / flash_budget
+                printf "\ndata:   %6d\nbss:    %6d\neeprom: %6d\n", data, bss, eeprom
+            }'
+        echo
+        awk -F'\t' -v call_overhead="$call_overhead" -v interrupt_frame="$interrupt_frame" -v nesting="$nesting" '
+            function depth(f,    c, d, best, n, i) {
+                if(f in memo) return memo[f]
+                visiting[f] = 1
+                best = 0; next_[f] = ""
+                n = split(callees[f], c, "\n")
+                for(i = 1; i <= n; i++) {
+                    if(c[i] == "") continue
+                    if(visiting[c[i]]) { recursive[c[i]] = 1; continue }
+                    d = depth(c[i]) + call_overhead
+                    if(d > best) { best = d; next_[f] = c[i] }
+                }
+                visiting[f] = 0
+                if(!(f in su) && f != "") unknown[f] = 1
+                memo[f] = su[f] + best
+                return memo[f]
+            }
+            function path(f,    s) {
+                s = ""
+                while(f != "") { s = s "  " f " (" su[f] + 0 ")\n"; f = next_[f] }
+                return s
+            }
+            FILENAME ~ /su$/ { su[$1] = $2; if($3 != "static") dynamic[$1] = $3; next }
+            FILENAME ~ /calls$/ {
+                if($2 == "*") indirect[$1] = 1
+                else callees[$1] = callees[$1] $2 "\n"
+                next
+            }
+            FILENAME ~ /priorities$/ { priority[$1] = $2; priorities++; next }
+            FILENAME ~ /handlers$/ { handlers[++handlerCount] = $1; next }
+            END {
+                mainStack = depth("main")
+                printf "stack: main %d\n", mainStack
+                printf "%s", path("main")
+                interrupts = 0
+                for(i = 1; i <= handlerCount; i++) {
+                    h = handlers[i]
+                    d = depth(h) + interrupt_frame
+                    if(nesting == "priority") {
+                        #unknown: the default priority (0), without IRQ_PRIORITY: every handler nests
+                        level = (h in priority) ? priority[h] : (priorities ? 0 : "#" i)
+                        printf "stack: %s %d (priority %s)\n", h, d, level
+                        if(d > levelMax[level]) levelMax[level] = d
+                    } else {
+                        printf "stack: %s %d\n", h, d
+                        if(d > interrupts) interrupts = d
+                    }
+                }
+                if(nesting == "priority")
+                    for(level in levelMax) interrupts += levelMax[level]
+                printf "stack: worst case %d (main %d + interrupts %d)\n", mainStack + interrupts, mainStack, interrupts
+                for(f in recursive) printf "recursive (not followed): %s\n", f
+                for(f in indirect) if(f in memo) printf "indirect call (not followed): %s\n", f
+                for(f in dynamic) if(f in memo) printf "dynamic stack (%s): %s\n", dynamic[f], f
+                for(f in unknown) printf "no stack usage (0): %s\n", f
+            }' "$tmp/su" "$tmp/calls" "$tmp/priorities" "$tmp/handlers"
+        echo
+        echo "symbols (size type name):"
+        "${BINUTILS}nm" -S -C -t d --size-sort -r "$elf" | cut -d' ' -f2- | sed -E 's/^0+([0-9])/\1/'
+    } > "$report"
+    rm -rf "$tmp"
+
+    local flash=$(sed -n 's/^flash: *\([0-9]*\).*/\1/p' "$report")
+    local ram=$(( $(sed -n 's/^data: *//p' "$report") + $(sed -n 's/^bss: *//p' "$report") ))
+    local stack=$(sed -n 's/^stack: worst case \([0-9]*\).*/\1/p' "$report")
+    local status=
+    if [ "$flash_budget" -gt 0 -a "$flash" -gt "$flash_budget" ]; then status="$status FLASH"; fi
+    if [ "$ram_budget" -gt 0 -a $((ram + stack)) -gt "$ram_budget" ]; then status="$status RAM"; fi
+    printf "%-36s flash %6d/%-6d ram %5d + stack %5d / %-5d %s\n" "$target" "$flash" "$flash_budget" \
+        "$ram" "$stack" "$ram_budget" "${status:+over budget:}${status:-ok}"
+    [ -z "$status" ]
+}
+
+result=0
+for elf in "$@"; do
+    footprint "$elf" || result=1
+done
+exit $result
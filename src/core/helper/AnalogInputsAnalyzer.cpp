@@ -39,6 +39,9 @@
 #include "LcdPrint.h"
 #include "PolarityCheck.h"
 #include "Menu.h"
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+#include "AnalogInputsNoise.h"
+#endif
 
 namespace AnalogInputsAnalyzer {
 
@@ -108,8 +111,14 @@ const AnalogInputs::Name voltageName[] PROGMEM = {
 };
 
 
+//type: 0 - avr ADC, 1 - real, 2 - ADC
+//3 - noise sigma (LSB x100), 4 - ENOB (bits x100) of the selected input
 uint8_t type = 0;
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+#define MAX_TYPE 5
+#else
 #define MAX_TYPE 3
+#endif
 
 static uint8_t dig_ = 5;
 
@@ -122,6 +131,14 @@ static void printItem(uint8_t index) {
             value = AnalogInputs::getAvrADCValue(name);
         } else if (type == 1) {
             value = AnalogInputs::getRealValue(name);
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+        } else if (type >= 3) {
+            if(index == Menu::getIndex()) {
+                AnalogInputsNoise::setInput(name);
+            }
+            if(type == 3) value = AnalogInputsNoise::getStdDev(name);
+            else value = AnalogInputsNoise::getENOB(name);
+#endif
         } else {
             ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
                 value = AnalogInputs::getADCValue(name);
@@ -138,6 +155,9 @@ static void printItem(uint8_t index) {
 
 void run() {
     SerialLog::powerOn();
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+    AnalogInputsNoise::powerOn();
+#endif
     AnalogInputs::powerOn();
     Balancer::powerOn();
     PolarityCheck::checkReversedPolarity_ = false;
@@ -152,6 +172,9 @@ void run() {
             type ++;
             if(type >= MAX_TYPE) {
                 type = 0;
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+                AnalogInputsNoise::powerOff();
+#endif
             }
         } else {
             Balancer::powerOff();
@@ -0,0 +1,246 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Hardware.h"
+#include "AnalogInputsNoise.h"
+#include "SerialLog.h"
+#include "Utils.h"
+
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+
+#define NOISE_NO_INPUT      0xff
+
+namespace AnalogInputsNoise {
+
+volatile uint8_t i_name_ = NOISE_NO_INPUT;
+volatile uint16_t i_count_;
+uint16_t i_capture_[ANALOG_INPUTS_NOISE_CAPTURE];
+
+namespace {
+    AnalogInputs::Name name_;
+    uint8_t captures_;
+
+    //samples relative to the first sample of the window (center_)
+    uint16_t center_;
+    int32_t sum_;
+    uint64_t sumSquares_;
+    uint16_t histogram_[ANALOG_INPUTS_NOISE_BINS];
+
+    //Allan variance: squared differences of the consecutive block sums
+    uint64_t allanSum_[ANALOG_INPUTS_NOISE_LEVELS];
+    uint16_t allanCount_[ANALOG_INPUTS_NOISE_LEVELS];
+
+    uint16_t stdDev_[AnalogInputs::PHYSICAL_INPUTS];
+    uint16_t enob_[AnalogInputs::PHYSICAL_INPUTS];
+
+    uint32_t sqrtU64(uint64_t v)
+    {
+        uint64_t r = 0;
+        uint64_t bit = 1ULL << 62;
+        while(bit > v) bit >>= 2;
+        while(bit) {
+            if(v >= r + bit) {
+                v -= r + bit;
+                r = (r >> 1) + bit;
+            } else {
+                r >>= 1;
+            }
+            bit >>= 2;
+        }
+        return r;
+    }
+
+    //100 * log2(x), x > 0
+    uint16_t log2x100(uint32_t x)
+    {
+        uint8_t e = 0;
+        while(x >> (e + 1)) e++;
+        //mantissa 1.15 in [1, 2): the fraction bits by squaring
+        uint32_t m = e > 15 ? x >> (e - 15) : x << (15 - e);
+        uint16_t fraction = 0;
+        for(uint16_t bit = 128; bit; bit >>= 1) {
+            m = (m * m) >> 15;
+            if(m >= (2UL << 15)) {
+                m >>= 1;
+                fraction |= bit;
+            }
+        }
+        return e * 100 + (fraction * 100 + 128) / 256;
+    }
+
+    void clear()
+    {
+        captures_ = 0;
+        sum_ = 0;
+        sumSquares_ = 0;
+        for(uint8_t i = 0; i < ANALOG_INPUTS_NOISE_BINS; i++) histogram_[i] = 0;
+        for(uint8_t k = 0; k < ANALOG_INPUTS_NOISE_LEVELS; k++) {
+            allanSum_[k] = 0;
+            allanCount_[k] = 0;
+        }
+    }
+
+    void addCapture()
+    {
+        if(captures_ == 0) {
+            center_ = i_capture_[0];
+        }
+        for(uint16_t i = 0; i < ANALOG_INPUTS_NOISE_CAPTURE; i++) {
+            int16_t d = i_capture_[i] - center_;
+            sum_ += d;
+            sumSquares_ += int32_t(d) * d;
+            int16_t bin = d + ANALOG_INPUTS_NOISE_BINS/2;
+            if(bin < 0) bin = 0;
+            if(bin >= ANALOG_INPUTS_NOISE_BINS) bin = ANALOG_INPUTS_NOISE_BINS - 1;
+            histogram_[bin]++;
+        }
+        for(uint8_t k = 0; k < ANALOG_INPUTS_NOISE_LEVELS; k++) {
+            uint16_t n = 1 << k;
+            int32_t previous = 0;
+            for(uint16_t i = 0; i + n <= ANALOG_INPUTS_NOISE_CAPTURE; i += n) {
+                int32_t s = 0;
+                for(uint16_t j = i; j < i + n; j++) s += i_capture_[j];
+                if(i) {
+                    int64_t d = s - previous;
+                    allanSum_[k] += d * d;
+                    allanCount_[k]++;
+                }
+                previous = s;
+            }
+        }
+        captures_++;
+    }
+
+    uint32_t getSamples()
+    {
+        return uint32_t(captures_) * ANALOG_INPUTS_NOISE_CAPTURE;
+    }
+
+    //variance << 16
+    uint64_t getVariance()
+    {
+        uint32_t n = getSamples();
+        int64_t mean = (int64_t(sum_) << 8) / n;
+        uint64_t m2 = (sumSquares_ << 16) / n;
+        uint64_t mean2 = mean * mean;
+        return m2 > mean2 ? m2 - mean2 : 0;
+    }
+
+    //ADEV(n) = sqrt(<(S[i+1] - S[i])^2> / (2 n^2)), S: sum of n samples
+    uint16_t getAllanDeviation(uint8_t k)
+    {
+        if(allanCount_[k] == 0)
+            return 0;
+        uint64_t v = allanSum_[k] * 10000 / allanCount_[k];
+        return sqrtU64(v >> (2 * k + 1));
+    }
+
+    void send()
+    {
+        uint32_t n = getSamples();
+        if(!SerialLog::beginChannel(4))
+            return;
+        SerialLog::printUInt(name_);
+        SerialLog::printD();
+        SerialLog::printLong(n);
+        SerialLog::printD();
+        SerialLog::printLong(int32_t(center_) * 100 + int64_t(sum_) * 100 / int32_t(n));
+        SerialLog::printD();
+        SerialLog::printUInt(stdDev_[name_]);
+        SerialLog::printD();
+        SerialLog::printUInt(enob_[name_]);
+        SerialLog::printD();
+        for(uint8_t k = 0; k < ANALOG_INPUTS_NOISE_LEVELS; k++) {
+            SerialLog::printUInt(getAllanDeviation(k));
+            SerialLog::printD();
+        }
+        SerialLog::printInt(int16_t(center_) - ANALOG_INPUTS_NOISE_BINS/2);
+        SerialLog::printD();
+        for(uint8_t i = 0; i < ANALOG_INPUTS_NOISE_BINS; i++) {
+            SerialLog::printUInt(histogram_[i]);
+            SerialLog::printD();
+        }
+        SerialLog::sendEnd();
+    }
+
+    void finalizeWindow()
+    {
+        //sigma << 8, sigma * sqrt(12): the step of an ideal ADC with the same noise
+        uint32_t sigma = sqrtU64(getVariance());
+        uint32_t step = (sigma * 3547 + 512) / 1024;
+        int16_t enob = ANALOG_INPUTS_ADC_RESOLUTION_BITS * 100;
+        if(step > 256) {
+            enob -= log2x100(step) - 800;
+            if(enob < 0) enob = 0;
+        }
+        stdDev_[name_] = (sigma * 100 + 128) / 256;
+        enob_[name_] = enob;
+        send();
+    }
+}
+
+void powerOn()
+{
+    for(uint8_t i = 0; i < AnalogInputs::PHYSICAL_INPUTS; i++) {
+        stdDev_[i] = 0;
+        enob_[i] = 0;
+    }
+    i_name_ = NOISE_NO_INPUT;
+}
+
+void powerOff()
+{
+    i_name_ = NOISE_NO_INPUT;
+}
+
+void setInput(AnalogInputs::Name name)
+{
+    if(i_name_ == name)
+        return;
+    i_name_ = NOISE_NO_INPUT;
+    name_ = name;
+    clear();
+    i_count_ = 0;
+    i_name_ = name;
+}
+
+void doIdle()
+{
+    //the capture is full: the ADC interrupt doesn't touch it
+    if(i_name_ == NOISE_NO_INPUT || i_count_ < ANALOG_INPUTS_NOISE_CAPTURE)
+        return;
+    addCapture();
+    if(captures_ >= ANALOG_INPUTS_NOISE_WINDOW) {
+        finalizeWindow();
+        clear();
+    }
+    i_count_ = 0;
+}
+
+uint16_t getStdDev(AnalogInputs::Name name)
+{
+    return stdDev_[name];
+}
+
+uint16_t getENOB(AnalogInputs::Name name)
+{
+    return enob_[name];
+}
+
+} //namespace AnalogInputsNoise
+
+#endif //ENABLE_ANALOG_INPUTS_NOISE
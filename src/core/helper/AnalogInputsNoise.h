@@ -0,0 +1,72 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ANALOGINPUTSNOISE_H_
+#define ANALOGINPUTSNOISE_H_
+
+#include "AnalogInputs.h"
+
+/* raw ADC noise of one input (AnalogInputsAnalyzer)
+ *
+ * the ADC driver passes every sample of a burst to intterruptSample(),
+ * the samples of the selected input are captured (ANALOG_INPUTS_NOISE_CAPTURE
+ * in a row, over consecutive bursts), doIdle() processes a full capture
+ * and starts the next one. After ANALOG_INPUTS_NOISE_WINDOW captures:
+ *  - mean and standard deviation (LSB of the ADC)
+ *  - ENOB = ANALOG_INPUTS_ADC_RESOLUTION_BITS - log2(sigma * sqrt(12))
+ *  - Allan deviation of the mean of n = 1, 2, 4, ... samples
+ *    (within a capture), how much averaging helps
+ *  - histogram: ANALOG_INPUTS_NOISE_BINS LSB around the first sample,
+ *    the outliers go to the first/last bin
+ * are stored and sent on SerialLog:
+ *  "$4;program;time;input;samples;mean;sigma;ENOB;adev[LEVELS];first bin;histogram[BINS];CRC"
+ * (mean, sigma, ENOB, adev: x100)
+ */
+
+#ifndef ANALOG_INPUTS_NOISE_CAPTURE
+#define ANALOG_INPUTS_NOISE_CAPTURE     512
+#endif
+#define ANALOG_INPUTS_NOISE_WINDOW      16
+#define ANALOG_INPUTS_NOISE_BINS        32
+//n = 1 .. 2^(LEVELS-1), at least two blocks per capture
+#define ANALOG_INPUTS_NOISE_LEVELS      9
+
+namespace AnalogInputsNoise {
+    extern volatile uint8_t i_name_;
+    extern volatile uint16_t i_count_;
+    extern uint16_t i_capture_[ANALOG_INPUTS_NOISE_CAPTURE];
+
+    //called by the ADC driver for every sample (without the "16bit" shift)
+    inline void intterruptSample(uint8_t name, uint16_t sample) {
+        if(name == i_name_ && i_count_ < ANALOG_INPUTS_NOISE_CAPTURE) {
+            i_capture_[i_count_++] = sample;
+        }
+    }
+
+    void powerOn();
+    void powerOff();
+    void doIdle();
+
+    //restarts the statistics if the input changes
+    void setInput(AnalogInputs::Name name);
+
+    //the last window of an input (0 - not measured yet)
+    uint16_t getStdDev(AnalogInputs::Name name);
+    uint16_t getENOB(AnalogInputs::Name name);
+}
+
+#endif /* ANALOGINPUTSNOISE_H_ */
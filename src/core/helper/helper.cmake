@@ -1,6 +1,6 @@
 
 set(CORE_SOURCE
-AnalogInputsAnalyzer.cpp BalancePortAnalyzer.cpp helperMain.cpp LCDAnalyzer.cpp ADCKeyboardAnalyzer.cpp
+AnalogInputsAnalyzer.cpp AnalogInputsNoise.cpp BalancePortAnalyzer.cpp helperMain.cpp LCDAnalyzer.cpp ADCKeyboardAnalyzer.cpp
 )
 
 CHEALI_ADD("CORE_SOURCE_FILES" "${CORE_SOURCE}")
@@ -24,7 +24,8 @@
 #include "memory.h"
 #include "Settings.h"
 
-#define DELTA_COUNTS_PER_MINUTE (60/(ANALOG_INPUTS_DELTA_TIME_MILISECONDS/1000))
+//shortest deltaVout/deltaTextern window (at high charge rates)
+#define DELTA_MIN_TIME_MILISECONDS 10000
 
 namespace DeltaChargeStrategy {
 
@@ -40,6 +41,15 @@ namespace DeltaChargeStrategy {
 
 void DeltaChargeStrategy::powerOn()
 {
+    //shorter window above 1C: -dV and dT/dt come sooner
+    uint32_t window = ANALOG_INPUTS_DELTA_TIME_MILISECONDS;
+    if(ProgramData::battery.Ic > ProgramData::battery.capacity) {
+        window *= ProgramData::battery.capacity;
+        window /= ProgramData::battery.Ic;
+        if(window < DELTA_MIN_TIME_MILISECONDS)
+            window = DELTA_MIN_TIME_MILISECONDS;
+    }
+    AnalogInputs::setDeltaWindow(window);
     SimpleChargeStrategy::powerOn();
 }
 
@@ -57,8 +67,9 @@ Strategy::statusType DeltaChargeStrategy::doStrategy()
         return Strategy::COMPLETE;
     }
 
-    //we don't have enough data to compute delta values (we need at least 2)
-    if(AnalogInputs::getDeltaCount() < 2)
+    //we don't have enough data to compute delta values
+    //(the smoothed values lag by half a window)
+    if(AnalogInputs::getDeltaCount() < (AnalogInputs::getDeltaWindowCount() + 1) / 2)
         return Strategy::RUNNING;
 
     if(ProgramData::battery.enable_externT) {
@@ -70,7 +81,7 @@ Strategy::statusType DeltaChargeStrategy::doStrategy()
     }
 
     //ignore few first -dV values until output voltage is stable
-    bool dontIgnore = AnalogInputs::getDeltaCount() >= ProgramData::battery.deltaVIgnoreTime * DELTA_COUNTS_PER_MINUTE;
+    bool dontIgnore = AnalogInputs::getDeltaCount() >= ProgramData::battery.deltaVIgnoreTime * AnalogInputs::getDeltaCountsPerMinute();
     AnalogInputs::enableDeltaVoutMax(dontIgnore);
     if(dontIgnore) {
         if(ProgramData::battery.enable_deltaV) {
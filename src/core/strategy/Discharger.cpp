@@ -76,6 +76,10 @@ void Discharger::trySetIout(AnalogInputs::ValueType I)
     if(IoutSet_ == I) return;
     IoutSet_ = I;
     uint16_t value = AnalogInputs::reverseCalibrateValue(AnalogInputs::IdischargeSet, I);
+#ifdef ENABLE_DISCHARGER_PID
+    //the value is the start, the loop holds the measured current at I
+    hardware::setDischargerTarget(I ? AnalogInputs::reverseCalibrateValue(AnalogInputs::Idischarge, I) : 0);
+#endif
     setValue(value);
 }
 
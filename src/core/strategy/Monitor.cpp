@@ -195,6 +195,11 @@ void Monitor::powerOff()
     on_ = false;
 }
 
+bool Monitor::isPowerOn()
+{
+    return on_;
+}
+
 void Monitor::doSlowInterrupt()
 {
    if(SMPS::isWorking() || Discharger::isWorking())
@@ -32,6 +32,7 @@ namespace Monitor {
     void doIdle();
     void powerOn();
     void powerOff();
+    bool isPowerOn();
 
     uint32_t getTimeSec();
     uint32_t getTotalBalanceTimeSec();
@@ -24,7 +24,12 @@
 #define SMPS_MAX_CURRENT_CHANGE     ANALOG_AMP(0.200)
 #endif
 
+#ifdef ENABLE_SMPS_FEED_FORWARD
+//the PID is preloaded with the new duty cycle (feed-forward), no ramp
+#define SMPS_MAX_CURRENT_CHANGE_dM  ((AnalogInputs::ValueType)MAX_CHARGE_I)
+#else
 #define SMPS_MAX_CURRENT_CHANGE_dM  ((AnalogInputs::ValueType)(SMPS_MAX_CURRENT_CHANGE*0.7))
+#endif
 
 namespace SMPS {
     bool on_ = false;
@@ -32,6 +32,8 @@ namespace SMPS {
     //returns the truly set Iout
     AnalogInputs::ValueType getIout();
     void trySetIout(AnalogInputs::ValueType I);
+    //charge current limit (power, settings)
+    AnalogInputs::ValueType getMaxIout();
 
     uint16_t getValue();
     void setValue(uint16_t value);
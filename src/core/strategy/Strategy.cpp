@@ -127,8 +127,8 @@ namespace Strategy {
                 status = Monitor::run();
                 run = analizeStrategyStatus(status);
 
-                if(run && newMesurmentData != AnalogInputs::getFullMeasurementCount()) {
-                    newMesurmentData = AnalogInputs::getFullMeasurementCount();
+                if(run && newMesurmentData != AnalogInputs::getMeasurementCount()) {
+                    newMesurmentData = AnalogInputs::getMeasurementCount();
                     status = strategyDoStrategy();
                     run = analizeStrategyStatus(status);
                 }
@@ -42,7 +42,7 @@ namespace TheveninMethod {
 
     Thevenin tVout_;
     Thevenin tBal_[MAX_BALANCE_CELLS];
-    uint8_t fullCount_;
+    uint16_t fullCount_;
 
     uint16_t lastBallancingEnded_;
     Strategy::statusType bstatus_;
@@ -127,7 +127,7 @@ bool TheveninMethod::balance_isComplete(bool isEndVout, AnalogInputs::ValueType
     }
 
     if(I <= getMinIwithBalancer() && isEndVout && state_ == ConstantVoltageBalancing) {
-        if(fullCount_++ >= 10) {
+        if(fullCount_++ >= 10 * ANALOG_INPUTS_SLIDING_WINDOW_BLOCKS) {
             return true;
         }
     } else {
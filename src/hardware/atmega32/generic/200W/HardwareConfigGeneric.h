@@ -40,7 +40,6 @@
 #define ANALOG_INPUTS_ADC_RESOLUTION_BITS   10
 #define ANALOG_INPUTS_ADC_BURST_COUNT       14
 #define ANALOG_INPUTS_ADC_ROUND_MAX_COUNT   40
-#define ANALOG_INPUTS_ADC_DELTA_SHIFT       1
 #define ENABLE_ANALOG_INPUTS_ADC_NOISE
 
 #define ANALOG_INPUTS_MAX_ADC_Vout_plus_pin     ANALOG_INPUTS_MAX_ADC_VALUE
@@ -16,12 +16,13 @@ namespace {
     volatile uint16_t i_PID_setpoint;
     //we have to use i_PID_CutOffVoltage, on some chargers (M0516) ADC can read up to 60V
     volatile uint16_t i_PID_CutOffVoltage;
+    //MV = I + P (+ D), all << PID_MV_PRECISION
     volatile long i_PID_MV;
+    volatile long i_PID_I;
+    volatile uint16_t i_PID_PV;
     volatile bool i_PID_enable;
 }
 
-#define A 4
-
 uint16_t hardware::getPIDValue()
 {
 //    return PID_setpoint;
@@ -47,30 +48,45 @@ void SMPS_PID::update()
         return;
     }
 
-    //TODO: rewrite PID
-    //this is the PID - actually it is an I (Integral part) - should be rewritten
     uint16_t PV = AnalogInputs::getADCValue(AnalogInputs::Ismps);
     long error = i_PID_setpoint;
     error -= PV;
-    i_PID_MV += error*A;
 
-    if(i_PID_MV<0) i_PID_MV = 0;
-    if(i_PID_MV > MAX_PID_MV_PRECISION) {
-        i_PID_MV = MAX_PID_MV_PRECISION;
+    long kp = PID_KP_BUCK, ki = PID_KI_BUCK, kd = PID_KD_BUCK;
+    if(i_PID_MV > ((long) TIMER1_PRECISION_PERIOD << PID_MV_PRECISION)) {
+        kp = PID_KP_BOOST; ki = PID_KI_BOOST; kd = PID_KD_BOOST;
     }
-    SMPS_PID::setPID_MV(i_PID_MV>>PID_MV_PRECISION);
+    long I = i_PID_I + error*ki;
+    long MV = I + error*kp;
+    MV -= ((long) PV - i_PID_PV)*kd;
+    i_PID_PV = PV;
+
+    //anti-windup: the integral is clamped with MV
+    //(with the default gains: the I only loop, as before)
+    long limited = MV;
+    if(limited < 0) limited = 0;
+    if(limited > (long) MAX_PID_MV_PRECISION) limited = MAX_PID_MV_PRECISION;
+    I -= MV - limited;
+    MV = limited;
+    i_PID_I = I;
+    i_PID_MV = MV;
+    SMPS_PID::setPID_MV(MV>>PID_MV_PRECISION);
 }
 
 void SMPS_PID::init(uint16_t Vin, uint16_t Vout)
 {
+    //no feed-forward (not tested on atmega32): the integral
+    //starts from the bottom of the buck or the boost region
+    long I = 0;
+    if(Vout>Vin) {
+        I = TIMER1_PRECISION_PERIOD;
+    }
+    I <<= PID_MV_PRECISION;
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
         i_PID_setpoint = 0;
-        if(Vout>Vin) {
-            i_PID_MV = TIMER1_PRECISION_PERIOD;
-        } else {
-            i_PID_MV = 0;
-        }
-        i_PID_MV <<= PID_MV_PRECISION;
+        i_PID_I = I;
+        i_PID_MV = I;
+        i_PID_PV = AnalogInputs::getADCValue(AnalogInputs::Ismps);
         i_PID_enable = true;
     }
 }
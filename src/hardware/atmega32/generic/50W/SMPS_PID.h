@@ -16,6 +16,30 @@
 #define PID_MV_PRECISION 8
 #define MAX_PID_MV_PRECISION (((uint32_t) MAX_PID_MV)<<PID_MV_PRECISION)
 
+//PI(D) gains: MV << PID_MV_PRECISION per Ismps ADC unit (error),
+//the D part is on the measurement (no kick on a setpoint change), 0 - off.
+//The boost region (MV > TIMER1_PRECISION_PERIOD) has a higher loop gain:
+//dVout/dMV = Vin/(1-D)^2 instead of Vin.
+//Not tuned on atmega32 yet: the I part only, as before
+#ifndef PID_KP_BUCK
+#define PID_KP_BUCK     0
+#endif
+#ifndef PID_KI_BUCK
+#define PID_KI_BUCK     4
+#endif
+#ifndef PID_KD_BUCK
+#define PID_KD_BUCK     0
+#endif
+#ifndef PID_KP_BOOST
+#define PID_KP_BOOST    0
+#endif
+#ifndef PID_KI_BOOST
+#define PID_KI_BOOST    4
+#endif
+#ifndef PID_KD_BOOST
+#define PID_KD_BOOST    0
+#endif
+
 namespace SMPS_PID
 {
     void init(uint16_t Vin, uint16_t Vout);
@@ -0,0 +1,722 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "Benchmark.h"
+#include "atomic.h"
+#include "cpu.h"
+#include "Utils.h"
+#include "LcdPrint.h"
+#include "AnalogInputs.h"
+#include "AnalogInputsPrivate.h"
+#include "eeprom.h"
+#include "memory.h"
+#include "ProgramData.h"
+#include "Monitor.h"
+#include "Thevenin.h"
+#include "outputPWMModulator.h"
+
+#define BENCH_RUNS          5
+#define BENCH_MIN_RUN_NS    20000000
+#define BENCH_INPUTS        16
+
+//spectrum: BENCH_SPECTRUM_N PWM periods (after BENCH_SPECTRUM_SETTLE) of
+//BENCH_SPECTRUM_VALUES duty cycles, in band: below 32kHz/BENCH_SPECTRUM_OSR
+#define BENCH_SPECTRUM_N        8192
+#define BENCH_SPECTRUM_SETTLE   1024
+#define BENCH_SPECTRUM_VALUES   64
+#define BENCH_SPECTRUM_OSR      32
+
+//calibration: random two point calibrations, every 16bit value
+#define BENCH_CALIBRATION_PAIRS 3000
+
+//stable: the SerialLog "$1" inputs (SerialLog::channel1)
+#define BENCH_LOG_VOUT_BALANCER 0
+#define BENCH_LOG_IOUT          1
+#define BENCH_LOG_VB1           8
+#define BENCH_LOG_FIELDS        (BENCH_LOG_VB1 + MAX_BALANCE_CELLS)
+#define BENCH_STABLE_STREAMS    (MAX_BALANCE_CELLS + 2)
+
+//trim: bursts of ANALOG_INPUTS_ADC_BURST_COUNT (+2) samples: a level with
+//gaussian noise and positive spikes (SMPS switching), or a capture (stdin)
+#define BENCH_TRIM_BURSTS       4096
+#define BENCH_TRIM_SAMPLES      (BENCH_TRIM_BURSTS * (ANALOG_INPUTS_ADC_BURST_COUNT + 2))
+#define BENCH_TRIM_LEVEL        2000
+#define BENCH_TRIM_SIGMA        2.0
+#define BENCH_TRIM_SPIKE        64
+
+//LcdPrint.cpp
+void lcdPrintValue_(uint16_t x, int8_t dig, uint16_t div, bool mili, bool minus);
+//AnalogInputs.cpp (finalizeVirtual cases)
+namespace AnalogInputs { void finalizeFullVirtualMeasurement(); }
+
+namespace Benchmark {
+
+namespace {
+    //not const: the compiler can't fold the calls
+    int32_t longs_[BENCH_INPUTS] = {
+        0, 7, -12, 345, -6789, 10000, 65535, -99999,
+        123456, -1000000, 2147483647, 42, -1, 999, 31000, -2147483647
+    };
+    uint16_t values_[BENCH_INPUTS] = {
+        0, 1, 9, 99, 1000, 1234, 3700, 4200,
+        8000, 12600, 16800, 25200, 33333, 40000, 50000, 65535
+    };
+    volatile uint32_t sink_;
+
+    void benchPrintLong(uint32_t n)
+    {
+        char buf[16];
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = *printLong(longs_[i % BENCH_INPUTS], buf);
+    }
+
+    void benchDigits(uint32_t n)
+    {
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = digits(longs_[i % BENCH_INPUTS]);
+    }
+
+    void benchCountBits(uint32_t n)
+    {
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = countBits(values_[i % BENCH_INPUTS]);
+    }
+
+    void benchPow10(uint32_t n)
+    {
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = pow10(i % 5);
+    }
+
+    void benchLcdPrintValue(uint32_t n)
+    {
+        for(uint32_t i = 0; i < n; i++) {
+            if((i & 1) == 0)
+                lcdSetCursor0_0();
+            lcdPrintValue_(values_[i % BENCH_INPUTS], 8, 1000, i & 2, false);
+        }
+    }
+
+    void benchLcdPrintVoltage(uint32_t n)
+    {
+        for(uint32_t i = 0; i < n; i++) {
+            if((i & 1) == 0)
+                lcdSetCursor0_0();
+            lcdPrintVoltage(values_[i % BENCH_INPUTS], 7);
+        }
+    }
+
+    Thevenin getThevenin()
+    {
+        Thevenin t;
+        t.init(ANALOG_VOLT(11.100), ANALOG_VOLT(12.600), ANALOG_AMP(2.000), true);
+        t.calculateRthVth(ANALOG_VOLT(11.400), ANALOG_AMP(1.000));
+        return t;
+    }
+
+    void benchTheveninCalculateI(uint32_t n)
+    {
+        Thevenin t = getThevenin();
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = t.calculateI(ANALOG_VOLT(11.000) + values_[i % BENCH_INPUTS] / 16);
+    }
+
+    void benchTheveninCalculateVth(uint32_t n)
+    {
+        Thevenin t = getThevenin();
+        for(uint32_t i = 0; i < n; i++) {
+            t.calculateVth(ANALOG_VOLT(11.000) + values_[i % BENCH_INPUTS] / 16, values_[(i + 5) % BENCH_INPUTS] / 16);
+            sink_ = t.Vth_;
+        }
+    }
+
+    void benchEvalI(uint32_t n)
+    {
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = AnalogInputs::evalI(values_[i % BENCH_INPUTS], values_[(i + 7) % BENCH_INPUTS] | 1);
+    }
+
+    void benchGetChargeProcent(uint32_t n)
+    {
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = Monitor::getChargeProcent();
+    }
+
+    void benchGetCharge(uint32_t n)
+    {
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = AnalogInputs::getCharge();
+    }
+
+    //a 3S pack on the balance port
+    void setMeasurement()
+    {
+        using namespace AnalogInputs;
+        real_[Vout_plus_pin] = ANALOG_VOLT(11.400);
+        real_[Vout_minus_pin] = 0;
+        for(uint8_t i = 0; i < MAX_BALANCE_CELLS; i++)
+            real_[Vb1_pin + i] = i < 3 ? ANALOG_VOLT(3.800) : 0;
+    }
+
+    //the lazy inputs: only what every measurement needs
+    void benchFinalizeVirtual(uint32_t n)
+    {
+        setMeasurement();
+        for(uint32_t i = 0; i < n; i++)
+            AnalogInputs::finalizeFullVirtualMeasurement();
+    }
+
+    //the eager calculation (before): Pout, Cout and Eout read after every measurement
+    void benchFinalizeVirtualRead(uint32_t n)
+    {
+        setMeasurement();
+        for(uint32_t i = 0; i < n; i++) {
+            AnalogInputs::finalizeFullVirtualMeasurement();
+            sink_ = AnalogInputs::getRealValue(AnalogInputs::Pout);
+            sink_ = AnalogInputs::getRealValue(AnalogInputs::Cout);
+            sink_ = AnalogInputs::getRealValue(AnalogInputs::Eout);
+        }
+    }
+
+    //the ADC interrupt (nuvoton AnalogInputsADC.cpp): one sample of a burst,
+    //minMax: the smallest and the biggest one are tracked (trim_)
+    volatile uint32_t burstSum_;
+    volatile uint16_t burstMin_, burstMax_;
+
+    template<bool minMax>
+    void benchAdcSample(uint32_t n)
+    {
+        burstSum_ = 0;
+        burstMin_ = 0xffff;
+        burstMax_ = 0;
+        for(uint32_t i = 0; i < n; i++) {
+            uint16_t v = BENCH_TRIM_LEVEL + values_[i % BENCH_INPUTS] % 8;
+            burstSum_ += v;
+            if(minMax) {
+                if(v < burstMin_) burstMin_ = v;
+                if(v > burstMax_) burstMax_ = v;
+            }
+        }
+    }
+
+    template<class M>
+    void benchModulator(uint32_t n)
+    {
+        M m;
+        m.reset();
+        for(uint32_t i = 0; i < n; i++)
+            sink_ = m.next(values_[i % BENCH_INPUTS] >> 1);
+    }
+
+    struct Case {
+        const char * name;
+        void (*run)(uint32_t n);
+    };
+
+    const Case cases_[] = {
+        {"printLong",                   benchPrintLong},
+        {"digits",                      benchDigits},
+        {"countBits",                   benchCountBits},
+        {"pow10",                       benchPow10},
+        {"lcdPrintValue_",              benchLcdPrintValue},
+        {"lcdPrintVoltage",             benchLcdPrintVoltage},
+        {"Thevenin::calculateI",        benchTheveninCalculateI},
+        {"Thevenin::calculateVth",      benchTheveninCalculateVth},
+        {"AnalogInputs::evalI",         benchEvalI},
+        {"Monitor::getChargeProcent",   benchGetChargeProcent},
+        {"AnalogInputs::getCharge",     benchGetCharge},
+        {"finalizeVirtual",             benchFinalizeVirtual},
+        {"finalizeVirtual+read",        benchFinalizeVirtualRead},
+        {"adcSample",                   benchAdcSample<false>},
+        {"adcSample+minMax",            benchAdcSample<true>},
+        {"outputPWM::Modulator1",       benchModulator<outputPWM::Modulator1>},
+        {"outputPWM::Modulator2",       benchModulator<outputPWM::Modulator2<false> >},
+        {"outputPWM::Modulator2dither", benchModulator<outputPWM::Modulator2<true> >},
+    };
+
+    uint64_t getClock()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    uint64_t timeRun(const Case &c, uint32_t n)
+    {
+        uint64_t begin = getClock();
+        c.run(n);
+        return getClock() - begin;
+    }
+
+    int compare(const void * a, const void * b)
+    {
+        double x = *(const double *) a, y = *(const double *) b;
+        return x < y ? -1 : x > y;
+    }
+
+    void timeCase(const Case &c)
+    {
+        uint32_t n = 1;
+        while(timeRun(c, n) < BENCH_MIN_RUN_NS && n < (1UL << 30))
+            n *= 2;
+
+        double ns[BENCH_RUNS];
+        for(uint8_t r = 0; r < BENCH_RUNS; r++)
+            ns[r] = double(timeRun(c, n)) / n;
+        qsort(ns, BENCH_RUNS, sizeof(ns[0]), compare);
+        printf("%-28s %8.1f %8.1f %12lu\n", c.name, ns[0], ns[BENCH_RUNS / 2], (unsigned long) n);
+    }
+
+    //in place radix 2 FFT, n: a power of 2
+    void fft(double * re, double * im, uint32_t n)
+    {
+        for(uint32_t i = 1, j = 0; i < n; i++) {
+            uint32_t bit = n >> 1;
+            for(; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if(i < j) {
+                double t = re[i]; re[i] = re[j]; re[j] = t;
+                t = im[i]; im[i] = im[j]; im[j] = t;
+            }
+        }
+        for(uint32_t length = 2; length <= n; length <<= 1) {
+            double a = -2 * M_PI / length;
+            for(uint32_t i = 0; i < n; i += length) {
+                for(uint32_t k = 0; k < length / 2; k++) {
+                    double wr = cos(a * k), wi = sin(a * k);
+                    double *r0 = &re[i + k], *i0 = &im[i + k];
+                    double *r1 = &re[i + k + length / 2], *i1 = &im[i + k + length / 2];
+                    double tr = *r1 * wr - *i1 * wi, ti = *r1 * wi + *i1 * wr;
+                    *r1 = *r0 - tr; *i1 = *i0 - ti;
+                    *r0 += tr; *i0 += ti;
+                }
+            }
+        }
+    }
+
+    //CMR error power [LSB^2]: in band, total, the biggest in band bin
+    struct Spectrum {
+        double inBand, total, tone;
+    };
+
+    //the CMR sequence of a constant value, Hann window
+    template<class M>
+    void getSpectrum(uint32_t value, Spectrum &s)
+    {
+        static double re[BENCH_SPECTRUM_N], im[BENCH_SPECTRUM_N];
+        M m;
+        m.reset();
+        for(uint32_t i = 0; i < BENCH_SPECTRUM_SETTLE; i++)
+            m.next(value);
+        double mean = double(value) / OUTPUT_PWM_PRECISION_FACTOR, window = 0;
+        for(uint32_t i = 0; i < BENCH_SPECTRUM_N; i++) {
+            double w = 0.5 - 0.5 * cos(2 * M_PI * i / BENCH_SPECTRUM_N);
+            re[i] = (m.next(value) - mean) * w;
+            im[i] = 0;
+            window += w * w;
+        }
+        fft(re, im, BENCH_SPECTRUM_N);
+        //one sided, the first two bins: the window main lobe of the DC
+        s.inBand = s.total = s.tone = 0;
+        for(uint32_t k = 2; k < BENCH_SPECTRUM_N / 2; k++) {
+            double p = 2 * (re[k] * re[k] + im[k] * im[k]) / (BENCH_SPECTRUM_N * window);
+            s.total += p;
+            if(k <= BENCH_SPECTRUM_N / BENCH_SPECTRUM_OSR) {
+                s.inBand += p;
+                if(p > s.tone) s.tone = p;
+            }
+        }
+    }
+
+    //average power over the duty cycles (10 - 90%, every fraction of a CMR step), the worst tone
+    template<class M>
+    void printSpectrum(const char * name)
+    {
+        Spectrum sum = {0, 0, 0};
+        for(uint32_t i = 0; i < BENCH_SPECTRUM_VALUES; i++) {
+            uint32_t cmr = OUTPUT_PWM_PERIOD / 10 + i * (OUTPUT_PWM_PERIOD * 8 / 10) / BENCH_SPECTRUM_VALUES;
+            uint32_t fraction = i * OUTPUT_PWM_PRECISION_FACTOR / BENCH_SPECTRUM_VALUES;
+            Spectrum s;
+            getSpectrum<M>(cmr * OUTPUT_PWM_PRECISION_FACTOR + fraction, s);
+            sum.inBand += s.inBand / BENCH_SPECTRUM_VALUES;
+            sum.total += s.total / BENCH_SPECTRUM_VALUES;
+            if(s.tone > sum.tone) sum.tone = s.tone;
+        }
+        printf("%-28s %12.5f %12.4f %10.1f\n", name, sqrt(sum.inBand), sqrt(sum.total),
+                10 * log10(sum.tone + 1e-30));
+    }
+
+    void runSpectrum()
+    {
+        printf("%-28s %12s %12s %10s\n", "modulator [CMR LSB rms]", "in band", "total", "tone[dB]");
+        printSpectrum<outputPWM::Modulator1>("outputPWM::Modulator1");
+        printSpectrum<outputPWM::Modulator2<false> >("outputPWM::Modulator2");
+        printSpectrum<outputPWM::Modulator2<true> >("outputPWM::Modulator2dither");
+        printf("\n%-28s %8s %8s %12s\n", "case [ns/call]", "best", "median", "iterations");
+        for(uint8_t i = 0; i < sizeOfArray(cases_); i++) {
+            if(!strncmp(cases_[i].name, "outputPWM::", 11))
+                timeCase(cases_[i]);
+        }
+    }
+
+    //the two point formula before the calibration tables (division),
+    //64bit: the 32bit product of the original code overflows for big values
+    AnalogInputs::ValueType calibrateDivision(AnalogInputs::ValueType x,
+            const AnalogInputs::CalibrationPoint &p0, const AnalogInputs::CalibrationPoint &p1)
+    {
+        if(x == 0) return 0;
+        int64_t y = p1.y;
+        y -= p0.y;
+        y *= int32_t(x) - p0.x;
+        y /= int32_t(p1.x) - p0.x;
+        y += p0.y;
+        if(y < 0) y = 0;
+        if(y > UINT16_MAX) y = UINT16_MAX;
+        return y;
+    }
+
+    uint32_t random_ = 1;
+
+    uint16_t getRandom()
+    {
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        return random_;
+    }
+
+    //calibrateValue()/reverseCalibrateValue() against calibrateDivision(), on a
+    //scratch input: the calibration points are changed in RAM only (not saved)
+    void runCalibration()
+    {
+        using namespace AnalogInputs;
+        const Name name = Vin;
+        AnalogInputs::Calibration saved = eeprom::data.calibration[name];
+        CalibrationPoint p[2];
+        uint64_t values = 0, errors = 0;
+        uint32_t pairs = 0;
+        while(pairs < BENCH_CALIBRATION_PAIRS) {
+            //the default calibrations first, then random points
+            if(pairs < PHYSICAL_INPUTS) {
+                p[0] = pgm::read<CalibrationPoint>(&inputsP_[pairs].p0);
+                p[1] = pgm::read<CalibrationPoint>(&inputsP_[pairs].p1);
+            } else {
+                //every 4th pair: a short segment (a steep or a flat slope)
+                p[0].x = getRandom(); p[0].y = getRandom();
+                p[1].x = getRandom(); p[1].y = getRandom();
+                if(pairs % 4 == 0) p[1].x = p[0].x + getRandom() % 32;
+                if(pairs % 8 == 1) p[1].y = p[0].y + getRandom() % 32;
+            }
+            //the division formula is not defined there
+            if(p[0].x == p[1].x)
+                continue;
+            pairs++;
+            eeprom::data.calibration[name].p[0] = p[0];
+            eeprom::data.calibration[name].p[1] = p[1];
+            for(uint8_t i = 2; i < ANALOG_INPUTS_MAX_CALIBRATION_POINTS; i++)
+                eeprom::data.calibration[name].p[i].x = eeprom::data.calibration[name].p[i].y = CALIBRATION_POINT_UNUSED;
+            updateCalibrationTable(name);
+
+            CalibrationPoint r[2] = {{p[0].y, p[0].x}, {p[1].y, p[1].x}};
+            uint32_t v = 0;
+            do {
+                ValueType expected = calibrateDivision(v, p[0], p[1]);
+                ValueType y = calibrateValue(name, v);
+                if(y != expected && errors++ == 0)
+                    printf("calibrateValue(%u): %u, expected: %u, p0: %u,%u p1: %u,%u\n",
+                            v, y, expected, p[0].x, p[0].y, p[1].x, p[1].y);
+                values++;
+                if(p[0].y == p[1].y)
+                    continue;
+                expected = calibrateDivision(v, r[0], r[1]);
+                y = reverseCalibrateValue(name, v);
+                if(y != expected && errors++ == 0)
+                    printf("reverseCalibrateValue(%u): %u, expected: %u, p0: %u,%u p1: %u,%u\n",
+                            v, y, expected, p[0].x, p[0].y, p[1].x, p[1].y);
+                values++;
+            } while(++v <= UINT16_MAX);
+        }
+        eeprom::data.calibration[name] = saved;
+        updateCalibrationTable(name);
+        printf("calibration: %u pairs, %llu values, %llu differences\n", pairs,
+                (unsigned long long) values, (unsigned long long) errors);
+        if(errors)
+            exit(1);
+    }
+
+    //isStable() of one recorded input: the time it is stable, how often the
+    //wait for STABLE_MIN_VALUE starts again and how long it takes (samples)
+    struct StableResult {
+        uint32_t samples, stable, restarts, waitSum;
+        uint32_t wait;
+        bool isStable;
+    };
+
+    void addStable(StableResult &r, bool stable)
+    {
+        r.samples++;
+        if(stable) {
+            r.stable++;
+            if(!r.isStable)
+                r.waitSum += r.wait;
+            r.wait = 0;
+        } else {
+            if(r.isStable)
+                r.restarts++;
+            r.wait++;
+        }
+        r.isStable = stable;
+    }
+
+    //waits: restarts + the first one
+    void printStable(const char * name, const StableResult &old, const StableResult &r, uint32_t waits, uint32_t oldWaits)
+    {
+        printf("%-14s %8u %7.1f %7.1f %9u %9u %8.1f %8.1f", name, r.samples,
+                100.0 * old.stable / old.samples, 100.0 * r.stable / r.samples, old.restarts, r.restarts,
+                double(old.waitSum) / oldWaits, double(r.waitSum) / waits);
+    }
+
+    //the stability detector (AnalogInputs::updateStable()) against the one it
+    //replaced (a counter, reset by a change > STABLE_VALUE_ERROR between two
+    //measurements) on the inputs of a recorded SerialLog (stdin)
+    void runStable()
+    {
+        using namespace AnalogInputs;
+        Name names[BENCH_STABLE_STREAMS];
+        uint8_t fields[BENCH_STABLE_STREAMS];
+        names[0] = VoutBalancer; fields[0] = BENCH_LOG_VOUT_BALANCER;
+        names[1] = Iout; fields[1] = BENCH_LOG_IOUT;
+        for(uint8_t i = 0; i < MAX_BALANCE_CELLS; i++) {
+            names[i + 2] = Name(Vb1 + i);
+            fields[i + 2] = BENCH_LOG_VB1 + i;
+        }
+        StableResult old[BENCH_STABLE_STREAMS], r[BENCH_STABLE_STREAMS];
+        ValueType last[BENCH_STABLE_STREAMS];
+        uint16_t oldCount[BENCH_STABLE_STREAMS];
+        bool used[BENCH_STABLE_STREAMS];
+        uint32_t noiseSum[BENCH_STABLE_STREAMS];
+        memset(old, 0, sizeof(old));
+        memset(r, 0, sizeof(r));
+        memset(used, 0, sizeof(used));
+        memset(noiseSum, 0, sizeof(noiseSum));
+
+        char line[512];
+        double lastTime = -1;
+        while(fgets(line, sizeof(line), stdin)) {
+            if(strncmp(line, "$1;", 3))
+                continue;
+            //$1;program;time;fields...
+            char * p = line + 3;
+            strtol(p, &p, 10);
+            double time = strtod(p + 1, &p);
+            ValueType v[BENCH_LOG_FIELDS];
+            uint8_t n = 0;
+            while(n < BENCH_LOG_FIELDS && *p == ';') {
+                v[n++] = strtoul(p + 1, &p, 10);
+            }
+            if(n < BENCH_LOG_FIELDS)
+                continue;
+            //a new session: AnalogInputs::resetMeasurement()
+            if(time < lastTime || lastTime < 0) {
+                resetStable();
+                memset(oldCount, 0, sizeof(oldCount));
+                memset(last, 0, sizeof(last));
+            }
+            lastTime = time;
+            for(uint8_t i = 0; i < BENCH_STABLE_STREAMS; i++) {
+                ValueType x = v[fields[i]];
+                //not connected balance port cells are left out
+                used[i] |= i == 1 ? x != 0 : x > CONNECTED_MIN_VOLTAGE;
+                if(absDiff(last[i], x) > STABLE_VALUE_ERROR) oldCount[i] = 0;
+                else oldCount[i]++;
+                last[i] = x;
+                addStable(old[i], oldCount[i] >= STABLE_MIN_VALUE);
+                updateStable(names[i], x);
+                addStable(r[i], isStable(names[i]));
+                noiseSum[i] += getNoise(names[i]);
+            }
+        }
+        printf("%-14s %8s %7s %7s %9s %9s %8s %8s %6s\n", "input", "samples", "old[%]", "new[%]",
+                "old rest", "new rest", "old wait", "new wait", "noise");
+        StableResult oldAll, all;
+        uint8_t streams = 0;
+        memset(&oldAll, 0, sizeof(oldAll));
+        memset(&all, 0, sizeof(all));
+        for(uint8_t i = 0; i < BENCH_STABLE_STREAMS; i++) {
+            if(!used[i] || !r[i].samples)
+                continue;
+            char name[16];
+            if(i < 2) strcpy(name, i ? "Iout" : "VoutBalancer");
+            else sprintf(name, "Vb%u", i - 1);
+            printStable(name, old[i], r[i], r[i].restarts + 1, old[i].restarts + 1);
+            printf(" %6u\n", noiseSum[i] / r[i].samples);
+            oldAll.samples += old[i].samples; oldAll.stable += old[i].stable;
+            oldAll.restarts += old[i].restarts; oldAll.waitSum += old[i].waitSum;
+            all.samples += r[i].samples; all.stable += r[i].stable;
+            all.restarts += r[i].restarts; all.waitSum += r[i].waitSum;
+            streams++;
+        }
+        if(streams) {
+            printStable("all", oldAll, all, all.restarts + streams, oldAll.restarts + streams);
+            printf(" %6s\n", "-");
+        }
+    }
+
+    uint16_t trimSamples_[BENCH_TRIM_SAMPLES];
+
+    //the mean and the standard deviation of the burst means [LSB]
+    struct TrimResult {
+        double mean, sigma;
+    };
+
+    //trim: burst_ + 2 samples minus the smallest and the biggest one,
+    //else: the first burst_ samples (the same conversion without trim_)
+    void getBurstMeans(uint32_t samples, bool trim, TrimResult &r)
+    {
+        const uint8_t length = ANALOG_INPUTS_ADC_BURST_COUNT + 2;
+        double sum = 0, sum2 = 0;
+        uint32_t bursts = samples / length;
+        for(uint32_t b = 0; b < bursts; b++) {
+            const uint16_t * s = &trimSamples_[b * length];
+            uint32_t x = 0;
+            uint16_t vMin = 0xffff, vMax = 0;
+            for(uint8_t i = 0; i < (trim ? length : ANALOG_INPUTS_ADC_BURST_COUNT); i++) {
+                x += s[i];
+                if(s[i] < vMin) vMin = s[i];
+                if(s[i] > vMax) vMax = s[i];
+            }
+            if(trim)
+                x -= vMin + vMax;
+            double mean = double(x) / ANALOG_INPUTS_ADC_BURST_COUNT;
+            sum += mean;
+            sum2 += mean * mean;
+        }
+        r.mean = sum / bursts;
+        r.sigma = sqrt(fmax(sum2 / bursts - r.mean * r.mean, 0));
+    }
+
+    void printTrim(const char * name, uint32_t samples)
+    {
+        TrimResult plain, trimmed;
+        getBurstMeans(samples, false, plain);
+        getBurstMeans(samples, true, trimmed);
+        printf("%-20s %10.3f %10.3f %10.3f %10.3f\n", name, plain.mean, plain.sigma, trimmed.mean, trimmed.sigma);
+    }
+
+    //gaussian (sum of 12 uniform), spikes: one in every "period" samples on average
+    void generateTrimSamples(uint16_t period)
+    {
+        for(uint32_t i = 0; i < BENCH_TRIM_SAMPLES; i++) {
+            double g = -6;
+            for(uint8_t k = 0; k < 12; k++)
+                g += getRandom() / 65536.0;
+            double v = BENCH_TRIM_LEVEL + BENCH_TRIM_SIGMA * g;
+            if(period && getRandom() % period == 0)
+                v += BENCH_TRIM_SPIKE;
+            trimSamples_[i] = lrint(v);
+        }
+    }
+
+    //the burst trim (trim_, see AnalogInputsADCSchedule.h): the noise of
+    //the burst means on generated bursts and on a capture (stdin: raw ADC
+    //samples of one input, in a row), then the interrupt cost per sample
+    void runTrim()
+    {
+        static const uint16_t periods[] = {0, 500, 140, 72, 20};
+        printf("%-20s %10s %10s %10s %10s\n", "data [LSB]", "mean", "sigma", "trim mean", "trim sigma");
+        for(uint8_t i = 0; i < sizeOfArray(periods); i++) {
+            char name[32];
+            if(periods[i]) sprintf(name, "spike 1/%u", periods[i]);
+            else strcpy(name, "no spikes");
+            generateTrimSamples(periods[i]);
+            printTrim(name, BENCH_TRIM_SAMPLES);
+        }
+        if(!isatty(fileno(stdin))) {
+            uint32_t samples = 0;
+            unsigned v;
+            while(samples < BENCH_TRIM_SAMPLES && scanf("%u", &v) == 1)
+                trimSamples_[samples++] = v;
+            if(samples >= ANALOG_INPUTS_ADC_BURST_COUNT + 2)
+                printTrim("capture", samples);
+        }
+        printf("\n%-28s %8s %8s %12s\n", "case [ns/sample]", "best", "median", "iterations");
+        for(uint8_t i = 0; i < sizeOfArray(cases_); i++) {
+            if(!strncmp(cases_[i].name, "adcSample", 9))
+                timeCase(cases_[i]);
+        }
+    }
+
+    //LiPo 3S, a sane state for Monitor::getChargeProcent()
+    void setBattery()
+    {
+        ProgramData::battery.type = ProgramData::Lipo;
+        ProgramData::battery.cells = 3;
+        ProgramData::battery.capacity = ANALOG_CHARGE(2.000);
+    }
+}
+
+void run()
+{
+    const char * config = cpu::getEnv("CHEALI_BENCH", NULL);
+    if(config == NULL)
+        return;
+
+    setBattery();
+    //the handlers (ADC, Plant, ...) must not run between the calls
+    __atomic_h_irq_count++;
+
+    if(!strcmp(config, "spectrum")) {
+        runSpectrum();
+    } else if(!strcmp(config, "calibration")) {
+        runCalibration();
+    } else if(!strcmp(config, "stable")) {
+        runStable();
+    } else if(!strcmp(config, "trim")) {
+        runTrim();
+    } else if(!strcmp(config, "list")) {
+        for(uint8_t i = 0; i < sizeOfArray(cases_); i++)
+            printf("%s\n", cases_[i].name);
+    } else if(const char * count = strchr(config, ':')) {
+        uint32_t n = strtoul(count + 1, NULL, 10);
+        size_t length = count - config;
+        uint8_t i = 0;
+        while(i < sizeOfArray(cases_)
+                && (strlen(cases_[i].name) != length || strncmp(cases_[i].name, config, length)))
+            i++;
+        if(i == sizeOfArray(cases_)) {
+            fprintf(stderr, "bench: unknown case: %s\n", config);
+            exit(1);
+        }
+        cases_[i].run(n);
+    } else {
+        printf("%-28s %8s %8s %12s\n", "case [ns/call]", "best", "median", "iterations");
+        for(uint8_t i = 0; i < sizeOfArray(cases_); i++)
+            timeCase(cases_[i]);
+    }
+    fflush(stdout);
+    exit(0);
+}
+
+} // namespace Benchmark
@@ -0,0 +1,66 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+/* host: microbenchmarks of the core arithmetic, CHEALI_BENCH
+ *
+ *  CHEALI_BENCH=1          time every case (host wall clock): the iterations
+ *                          are doubled until a run takes BENCH_MIN_RUN_NS,
+ *                          the best and the median of BENCH_RUNS runs are
+ *                          written to stdout, ns per call
+ *  CHEALI_BENCH=name:n     instruction count mode: only "name", n calls,
+ *                          no timing - for an external counter, e.g.
+ *      valgrind --tool=callgrind, perf stat -e instructions or
+ *      qemu-arm -plugin libinsn.so -d plugin (a Cortex-M0 build of the
+ *      host backend: arm-linux-gnueabi-g++ -mcpu=cortex-m0 -mthumb -static)
+ *                          per call: (count(n) - count(0)) / n
+ *  CHEALI_BENCH=list       the case names
+ *  CHEALI_BENCH=spectrum   the PWM modulators (outputPWMModulator.h): the CMR
+ *                          error of constant duty cycles (FFT), in band
+ *                          (below 1kHz) and total rms, the biggest in band
+ *                          tone (dB, 0: 1 LSB rms), then their time per call
+ *  CHEALI_BENCH=calibration calibrateValue()/reverseCalibrateValue() against
+ *                          the two point division formula (before the
+ *                          calibration tables): BENCH_CALIBRATION_PAIRS
+ *                          calibrations (the defaults, then random points),
+ *                          every 16bit value, exit status 1 on a difference
+ *  CHEALI_BENCH=stable     isStable() on the inputs of a recorded SerialLog
+ *                          (stdin, "$1" lines; e.g. CHEALI_SERIAL with the
+ *                          Scenario option uart=1): the stability detector
+ *                          against the STABLE_VALUE_ERROR counter it replaced -
+ *                          time stable, restarts (stable -> not stable), the
+ *                          mean wait (measurements), the mean noise (getNoise)
+ *  CHEALI_BENCH=trim       the ADC burst trim (trim_, AnalogInputsADCSchedule.h):
+ *                          the mean and sigma of the burst means, plain and
+ *                          trimmed, on generated bursts (gaussian noise, positive
+ *                          spikes) and on a capture (stdin, if not a terminal:
+ *                          raw samples of one input), then the interrupt cost
+ *                          per sample without and with the min/max tracking
+ *
+ * the cases run after hardware::initialize() (the calibration is loaded)
+ * with the interrupts disabled, the process exits afterwards.
+ * The lcdPrint cases include the host LCD (HD44780) emulation.
+ */
+
+namespace Benchmark {
+    //does nothing if CHEALI_BENCH is not set
+    void run();
+}
+
+#endif /* BENCHMARK_H_ */
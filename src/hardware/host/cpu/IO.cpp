@@ -0,0 +1,35 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "IO.h"
+#include "Hardware.h"
+#include "Terminal.h"
+
+namespace IO
+{
+    uint8_t pinValue_[256];
+    uint8_t pinMode_[256];
+
+    void digitalWrite(uint8_t pinNumber, uint8_t value)
+    {
+        uint8_t last = pinValue_[pinNumber];
+        pinValue_[pinNumber] = value ? HIGH : LOW;
+        //the LCD latches the data on the falling edge of enable
+        if(pinNumber == LCD_ENABLE_PIN && last == HIGH && !value)
+            Terminal::lcdEnable();
+    }
+}
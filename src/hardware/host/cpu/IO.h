@@ -0,0 +1,51 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef IO_H_
+#define IO_H_
+
+#include <stdint.h>
+
+#define OUTPUT 1
+#define INPUT 0
+#define ANALOG_INPUT 2
+#define HIGH 1
+#define LOW 0
+
+//host: the pins are in-memory registers
+namespace IO
+{
+    extern uint8_t pinValue_[256];
+    extern uint8_t pinMode_[256];
+
+    void digitalWrite(uint8_t pinNumber, uint8_t value);
+
+    inline uint8_t digitalRead(uint8_t pinNumber) {
+        return pinValue_[pinNumber];
+    }
+
+    inline void pinMode(uint8_t pinNumber, uint8_t mode) {
+        pinMode_[pinNumber] = mode;
+    }
+
+    //drive an input pin from outside (keyboard, tests)
+    inline void setInput(uint8_t pinNumber, uint8_t value) {
+        pinValue_[pinNumber] = value ? HIGH : LOW;
+    }
+}
+
+#endif /* IO_H_ */
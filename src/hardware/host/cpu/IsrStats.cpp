@@ -0,0 +1,161 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "IsrStats.h"
+
+namespace IsrStats {
+
+//histogram: 8 buckets per octave (< 12.5% error)
+#define HISTOGRAM_SUB_BITS  3
+#define HISTOGRAM_SIZE      (64 << HISTOGRAM_SUB_BITS)
+
+struct Stats {
+    uint64_t calls;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint32_t histogram[HISTOGRAM_SIZE];
+};
+
+namespace {
+    const char * const names_[SECTIONS] = {
+        "Timer0", "TimerADC", "Terminal (sim)", "Plant (sim)", "Fuzz (sim)", "SMPS_PID"
+    };
+    //counted as the firmware CPU load
+    const bool firmware_[SECTIONS] = {
+        true, true, false, false, false, false
+    };
+
+    double factor_;
+    Stats stats_[SECTIONS];
+    Stats load_;
+    uint64_t roundBusy_;
+    uint64_t roundStart_;
+
+    uint64_t getClock()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    uint16_t getBucket(uint64_t v)
+    {
+        if(v < (1 << HISTOGRAM_SUB_BITS))
+            return v;
+        uint8_t e = 63 - __builtin_clzll(v);
+        uint8_t shift = e - HISTOGRAM_SUB_BITS;
+        return ((shift + 1) << HISTOGRAM_SUB_BITS) + ((v >> shift) & ((1 << HISTOGRAM_SUB_BITS) - 1));
+    }
+
+    //lower bound of the bucket
+    uint64_t getBucketValue(uint16_t b)
+    {
+        if(b < (1 << HISTOGRAM_SUB_BITS))
+            return b;
+        uint8_t shift = (b >> HISTOGRAM_SUB_BITS) - 1;
+        return uint64_t((1 << HISTOGRAM_SUB_BITS) + (b & ((1 << HISTOGRAM_SUB_BITS) - 1))) << shift;
+    }
+
+    //the max is disturbed by the host scheduler, the 99.9th percentile is not
+    uint64_t getP999(const Stats &s)
+    {
+        uint64_t n = s.calls - s.calls / 1000;
+        uint64_t count = 0;
+        for(uint16_t b = 0; b < HISTOGRAM_SIZE; b++) {
+            count += s.histogram[b];
+            if(count >= n)
+                return getBucketValue(b);
+        }
+        return s.max;
+    }
+
+    void add(Stats &s, uint64_t v)
+    {
+        if(!s.calls || v < s.min) s.min = v;
+        if(v > s.max) s.max = v;
+        s.sum += v;
+        s.calls++;
+        s.histogram[getBucket(v)]++;
+    }
+
+    double scale(uint64_t ns)
+    {
+        return ns * factor_;
+    }
+
+    void report()
+    {
+        fprintf(stderr, "isr: handler time [ns] x %g\n", factor_);
+        fprintf(stderr, "isr: %-16s %10s %10s %10s %10s %10s\n", "handler", "calls", "min", "avg", "p99.9", "max");
+        for(uint8_t i = 0; i < SECTIONS; i++) {
+            const Stats &s = stats_[i];
+            if(!s.calls)
+                continue;
+            fprintf(stderr, "isr: %-16s %10llu %10.0f %10.0f %10.0f %10.0f\n", names_[i],
+                    (unsigned long long)s.calls, scale(s.min), scale(s.sum) / s.calls,
+                    scale(getP999(s)), scale(s.max));
+        }
+        if(load_.calls) {
+            //load_ is in 1/1000000 (ppm)
+            fprintf(stderr, "isr: ADC rounds: %llu, load min/avg/p99.9/max %.3f/%.3f/%.3f/%.3f%%\n",
+                    (unsigned long long)load_.calls, load_.min * 1e-4,
+                    double(load_.sum) / load_.calls * 1e-4, getP999(load_) * 1e-4, load_.max * 1e-4);
+        }
+    }
+}
+
+void initialize()
+{
+    factor_ = atof(cpu::getEnv("CHEALI_ISR_STATS", "0"));
+    if(factor_ > 0)
+        atexit(report);
+}
+
+uint64_t begin()
+{
+    if(factor_ <= 0)
+        return 0;
+    return getClock();
+}
+
+void end(uint8_t section, uint64_t begin)
+{
+    if(!begin)
+        return;
+    uint64_t t = getClock() - begin;
+    add(stats_[section], t);
+    if(firmware_[section])
+        roundBusy_ += t;
+}
+
+void round()
+{
+    if(factor_ <= 0)
+        return;
+    uint64_t now = cpu::getNanoseconds();
+    if(roundStart_ && now > roundStart_)
+        add(load_, uint64_t(scale(roundBusy_) * 1000000 / (now - roundStart_)));
+    roundStart_ = now;
+    roundBusy_ = 0;
+}
+
+} // namespace IsrStats
@@ -0,0 +1,51 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ISRSTATS_H_
+#define ISRSTATS_H_
+
+#include <stdint.h>
+#include "cpu.h"
+
+/* host: handler (interrupt) time statistics, CHEALI_ISR_STATS=factor
+ *
+ * the host time of every handler is measured (min/avg/max per call),
+ * the firmware handlers (Timer0, TimerADC) are summed up per ADC round
+ * and compared with the virtual length of the round - the CPU load.
+ * factor scales the host time to the target (a rough slowdown of the MCU,
+ * e.g. 30 for a 50MHz Cortex-M0), 0 - off (default), 1 - host time.
+ * The report is written to stderr at exit.
+ * Note: max includes the host scheduling noise.
+ */
+
+namespace IsrStats {
+    enum Section {
+        //0 .. cpu::TIMERS-1: the timer handlers
+        SectionPID = cpu::TIMERS,
+        SECTIONS
+    };
+
+    void initialize();
+
+    //0 if disabled
+    uint64_t begin();
+    void end(uint8_t section, uint64_t begin);
+    //end of an ADC round
+    void round();
+}
+
+#endif /* ISRSTATS_H_ */
@@ -0,0 +1,66 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Serial.h"
+#include "cpu.h"
+
+namespace Serial {
+
+namespace {
+    FILE * out_ = NULL;
+}
+
+void begin(unsigned long baud)
+{
+    const char * path = cpu::getEnv("CHEALI_SERIAL", NULL);
+    if(path == NULL || out_)
+        return;
+    //don't block if nobody reads the pipe yet
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_NONBLOCK, 0644);
+    if(fd < 0)
+        return;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    out_ = fdopen(fd, "a");
+}
+
+void write(uint8_t c)
+{
+    if(out_)
+        putc(c, out_);
+}
+
+void flush()
+{
+    if(out_)
+        fflush(out_);
+}
+
+void end()
+{
+    if(out_) {
+        fclose(out_);
+        out_ = NULL;
+    }
+}
+
+void initialize() {}
+
+} // namespace Serial
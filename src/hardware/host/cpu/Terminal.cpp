@@ -0,0 +1,295 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Terminal.h"
+#include "Hardware.h"
+#include "IO.h"
+#include "cpu.h"
+
+#define TERMINAL_INTERRUPT_PERIOD_MS    10
+#define KEY_PRESS_MS                    100
+#define KEY_LONG_PRESS_MS               3000
+#define KEY_RELEASE_MS                  200
+//a terminal is redrawn at most every 40ms (wall clock),
+//other outputs get a line every 100ms of virtual time (repeatable)
+#define DRAW_MIN_WALL_PERIOD_NS         40000000
+#define DRAW_MIN_PERIOD_NS              100000000
+
+namespace Terminal {
+
+namespace {
+    //HD44780
+    uint8_t ddram_[0x80];
+    uint8_t cgram_[0x40];
+    uint8_t address_;
+    bool cgramAccess_;
+    bool increment_ = true;
+    bool displayOn_;
+    bool fourBit_;
+    bool lowNibble_;
+    uint8_t highNibble_;
+    bool changed_;
+
+    bool draw_;
+    bool tty_;
+    uint64_t lastDraw_;
+
+    //keyboard
+    bool stdinEOF_;
+    bool rawMode_;
+    termios savedTermios_;
+    bool longPress_;
+    uint8_t pressedPin_;
+    uint16_t keyTimeMs_;
+
+    void execute(uint8_t rs, uint8_t v)
+    {
+        if(rs) {
+            if(cgramAccess_) {
+                cgram_[address_ & 0x3f] = v;
+            } else {
+                ddram_[address_ & 0x7f] = v;
+                changed_ = true;
+            }
+            if(increment_) address_++;
+            else address_--;
+            return;
+        }
+        if(v & 0x80) {
+            address_ = v & 0x7f;
+            cgramAccess_ = false;
+        } else if(v & 0x40) {
+            address_ = v & 0x3f;
+            cgramAccess_ = true;
+        } else if(v & 0x20) {
+            fourBit_ = !(v & 0x10);
+            lowNibble_ = false;
+        } else if(v & 0x10) {
+            //cursor/display shift - not used
+        } else if(v & 0x08) {
+            displayOn_ = v & 0x04;
+            changed_ = true;
+        } else if(v & 0x04) {
+            increment_ = v & 0x02;
+        } else if(v & 0x02) {
+            address_ = 0;
+            cgramAccess_ = false;
+        } else if(v & 0x01) {
+            memset(ddram_, ' ', sizeof(ddram_));
+            address_ = 0;
+            increment_ = true;
+            cgramAccess_ = false;
+            changed_ = true;
+        }
+    }
+
+    //user defined characters are drawn by the number of lit pixels
+    char getCGChar(uint8_t c)
+    {
+        uint8_t pixels = 0;
+        for(uint8_t i = 0; i < 8; i++)
+            pixels += __builtin_popcount(cgram_[(c & 7) * 8 + i] & 0x1f);
+        if(pixels < 10) return '_';
+        if(pixels < 24) return 'o';
+        return '#';
+    }
+
+    void restoreTermios()
+    {
+        if(rawMode_)
+            tcsetattr(0, TCSANOW, &savedTermios_);
+    }
+
+    void drawAtExit()
+    {
+        draw();
+        restoreTermios();
+    }
+
+    void setButton(uint8_t pin, bool pressed)
+    {
+        //active low
+        IO::setInput(pin, !pressed);
+    }
+
+    uint8_t getButtonPin(int c)
+    {
+        switch(c) {
+        case 's':   return BUTTON_STOP_PIN;
+        case '-':   return BUTTON_DEC_PIN;
+        case '+':   return BUTTON_INC_PIN;
+        case '\n':
+        case '\r':
+        case ' ':   return BUTTON_START_PIN;
+        default:    return 0;
+        }
+    }
+
+    void readKey()
+    {
+        if(stdinEOF_)
+            return;
+        pollfd p = {0, POLLIN, 0};
+        if(::poll(&p, 1, 0) <= 0)
+            return;
+        char c;
+        if(read(0, &c, 1) != 1) {
+            stdinEOF_ = true;
+            return;
+        }
+        if(c == 'q') {
+            exit(0);
+        } else if(c == 'l') {
+            longPress_ = true;
+        } else if(c == '.') {
+            keyTimeMs_ = 1000;
+        } else if(getButtonPin(c)) {
+            pressKey(c, longPress_);
+            longPress_ = false;
+        }
+    }
+
+    void doKeyboard()
+    {
+        if(keyTimeMs_ > TERMINAL_INTERRUPT_PERIOD_MS) {
+            keyTimeMs_ -= TERMINAL_INTERRUPT_PERIOD_MS;
+        } else if(pressedPin_) {
+            setButton(pressedPin_, false);
+            pressedPin_ = 0;
+            keyTimeMs_ = KEY_RELEASE_MS;
+        } else {
+            keyTimeMs_ = 0;
+            readKey();
+        }
+    }
+
+    uint64_t getWallClock()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+}
+
+void initialize()
+{
+    memset(ddram_, ' ', sizeof(ddram_));
+    setButton(BUTTON_STOP_PIN, false);
+    setButton(BUTTON_DEC_PIN, false);
+    setButton(BUTTON_INC_PIN, false);
+    setButton(BUTTON_START_PIN, false);
+
+    //fuzzing: the keys come from Fuzz (pressKey())
+    stdinEOF_ = cpu::isFuzzing();
+    tty_ = isatty(1);
+    draw_ = atoi(cpu::getEnv("CHEALI_LCD", tty_ ? "1" : "0"));
+
+    if(!stdinEOF_ && isatty(0) && tcgetattr(0, &savedTermios_) == 0) {
+        termios t = savedTermios_;
+        t.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(0, TCSANOW, &t);
+        rawMode_ = true;
+    }
+    if(tty_ && draw_)
+        printf("\033[2J");
+    atexit(drawAtExit);
+
+    cpu::startTimer(cpu::TimerTerminal, doInterrupt,
+            TERMINAL_INTERRUPT_PERIOD_MS * 1000000UL, TERMINAL_INTERRUPT_PERIOD_MS * 1000000UL);
+}
+
+bool pressKey(char c, bool longPress)
+{
+    if(pressedPin_ || keyTimeMs_)
+        return false;
+    if((pressedPin_ = getButtonPin(c))) {
+        setButton(pressedPin_, true);
+        keyTimeMs_ = longPress ? KEY_LONG_PRESS_MS : KEY_PRESS_MS;
+    }
+    return true;
+}
+
+void lcdEnable()
+{
+    uint8_t rs = IO::digitalRead(LCD_RS_PIN);
+    uint8_t v = IO::digitalRead(LCD_D0_PIN)
+            | IO::digitalRead(LCD_D1_PIN) << 1
+            | IO::digitalRead(LCD_D2_PIN) << 2
+            | IO::digitalRead(LCD_D3_PIN) << 3;
+
+    //the 4 data pins are connected to DB4-DB7
+    if(!fourBit_) {
+        execute(rs, v << 4);
+    } else if(!lowNibble_) {
+        highNibble_ = v;
+        lowNibble_ = true;
+    } else {
+        lowNibble_ = false;
+        execute(rs, (highNibble_ << 4) | v);
+    }
+}
+
+void getLine(char * buf, uint8_t line)
+{
+    for(uint8_t i = 0; i < LCD_COLUMNS; i++) {
+        uint8_t c = displayOn_ ? ddram_[line * 0x40 + i] : ' ';
+        if(c < 8) buf[i] = getCGChar(c);
+        else if(c < ' ' || c > '~') buf[i] = '?';
+        else buf[i] = c;
+    }
+    buf[LCD_COLUMNS] = 0;
+}
+
+void draw()
+{
+    if(!draw_)
+        return;
+    char buf[LCD_COLUMNS + 1];
+    if(tty_) {
+        printf("\033[H");
+    } else {
+        uint64_t ms = cpu::getNanoseconds() / 1000000;
+        printf("%6lu.%03lu\n", (unsigned long) (ms / 1000), (unsigned long) (ms % 1000));
+    }
+    for(uint8_t i = 0; i < LCD_LINES; i++) {
+        getLine(buf, i);
+        printf("|%s|\n", buf);
+    }
+    fflush(stdout);
+    lastDraw_ = tty_ ? getWallClock() : cpu::getNanoseconds();
+    changed_ = false;
+}
+
+void doInterrupt()
+{
+    doKeyboard();
+    if(!changed_)
+        return;
+    if(tty_ ? getWallClock() - lastDraw_ >= DRAW_MIN_WALL_PERIOD_NS
+            : cpu::getNanoseconds() - lastDraw_ >= DRAW_MIN_PERIOD_NS)
+        draw();
+}
+
+} // namespace Terminal
@@ -0,0 +1,47 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TERMINAL_H_
+#define TERMINAL_H_
+
+#include <stdint.h>
+
+/* host terminal:
+ *  - a HD44780 (4 bit mode) on the LCD pins, drawn on stdout
+ *  - keyboard on stdin, every key is pressed for KEY_PRESS_MS:
+ *      s - stop, "-" - dec, "+" - inc, enter/space - start,
+ *      l<key> - long press, "." - wait 1s (no key), q - quit
+ *    keys can be piped in: echo "l ..s" | ./cheali-charger
+ */
+
+namespace Terminal {
+    void initialize();
+
+    //press a button key ("s", "-", "+", " "), false: a key is still pressed
+    bool pressKey(char c, bool longPress = false);
+
+    //LCD_ENABLE_PIN falling edge
+    void lcdEnable();
+    //line content, as drawn (LCD_COLUMNS characters)
+    void getLine(char * buf, uint8_t line);
+    void draw();
+
+    //TimerTerminal handler
+    void doInterrupt();
+}
+
+#endif /* TERMINAL_H_ */
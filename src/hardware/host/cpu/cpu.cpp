@@ -0,0 +1,200 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "atomic.h"
+#include "memory.h"
+#include "Terminal.h"
+#include "IsrStats.h"
+
+#define REALTIME_CHECK_NS   1000000
+
+uint8_t __atomic_h_irq_count;
+
+namespace cpu {
+
+struct TimerState {
+    Interrupt handler;
+    uint64_t next;
+    uint32_t period;
+};
+
+namespace {
+    TimerState timers_[TIMERS];
+    uint64_t now_;
+    uint64_t nextEvent_;
+    bool inInterrupt_;
+
+    bool realtime_;
+    uint64_t realtimeCheck_;
+    uint64_t wallStart_;
+    uint64_t timeLimit_;
+    bool fuzzing_;
+
+    uint64_t getWallClock()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    void updateNextEvent()
+    {
+        nextEvent_ = UINT64_MAX;
+        for(uint8_t i = 0; i < TIMERS; i++) {
+            if(timers_[i].handler && timers_[i].next < nextEvent_)
+                nextEvent_ = timers_[i].next;
+        }
+    }
+
+    void callHandlers()
+    {
+        for(uint8_t i = 0; i < TIMERS; i++) {
+            TimerState &t = timers_[i];
+            if(!t.handler || t.next > now_)
+                continue;
+            Interrupt handler = t.handler;
+            if(t.period) {
+                //a missed period is lost, like a pending interrupt flag
+                do {
+                    t.next += t.period;
+                } while(t.next <= now_);
+            } else {
+                t.handler = NULL;
+            }
+            inInterrupt_ = true;
+            uint64_t begin = IsrStats::begin();
+            handler();
+            IsrStats::end(i, begin);
+            inInterrupt_ = false;
+        }
+        updateNextEvent();
+    }
+
+    void keepRealtime()
+    {
+        if(now_ < realtimeCheck_)
+            return;
+        realtimeCheck_ = now_ + REALTIME_CHECK_NS;
+        uint64_t wall = getWallClock() - wallStart_;
+        if(now_ > wall) {
+            timespec ts;
+            ts.tv_sec = (now_ - wall) / 1000000000;
+            ts.tv_nsec = (now_ - wall) % 1000000000;
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    void runUntil(uint64_t t)
+    {
+        if(__atomic_h_irq_count == 0 && !inInterrupt_) {
+            //interrupts enabled: call everything that is due (or pending)
+            while(nextEvent_ <= t) {
+                if(nextEvent_ > now_)
+                    now_ = nextEvent_;
+                callHandlers();
+            }
+        }
+        if(t > now_)
+            now_ = t;
+
+        if(realtime_)
+            keepRealtime();
+        if(timeLimit_ && now_ >= timeLimit_)
+            exit(0);
+    }
+}
+
+void init()
+{
+    __atomic_h_irq_count = 0;
+    realtime_ = atoi(getEnv("CHEALI_REALTIME", isatty(0) ? "1" : "0"));
+    timeLimit_ = uint64_t(atoi(getEnv("CHEALI_TIME_LIMIT", "0"))) * 1000000000;
+    fuzzing_ = atoi(getEnv("CHEALI_FUZZ", "0"));
+    wallStart_ = getWallClock() - now_;
+    updateNextEvent();
+
+    eeprom::load();
+    IsrStats::initialize();
+    Terminal::initialize();
+}
+
+void startTimer(uint8_t timer, Interrupt handler, uint32_t delayNs, uint32_t periodNs)
+{
+    TimerState &t = timers_[timer];
+    t.next = now_ + delayNs;
+    t.period = periodNs;
+    t.handler = handler;
+    updateNextEvent();
+}
+
+void stopTimer(uint8_t timer)
+{
+    timers_[timer].handler = NULL;
+    updateNextEvent();
+}
+
+uint64_t getNanoseconds()
+{
+    return now_;
+}
+
+bool inInterrupt()
+{
+    return inInterrupt_;
+}
+
+bool isFuzzing()
+{
+    return fuzzing_;
+}
+
+void poll()
+{
+    if(inInterrupt_)
+        return;
+    runUntil(now_ + CPU_POLL_PERIOD_NS);
+}
+
+void delay(uint32_t ns)
+{
+    runUntil(now_ + ns);
+}
+
+void waitForInterrupt()
+{
+    if(inInterrupt_ || __atomic_h_irq_count || nextEvent_ == UINT64_MAX) {
+        //nothing can wake us up
+        runUntil(now_ + CPU_POLL_PERIOD_NS);
+        return;
+    }
+    runUntil(nextEvent_ > now_ ? nextEvent_ : now_);
+}
+
+const char * getEnv(const char * name, const char * defaultValue)
+{
+    const char * v = getenv(name);
+    if(v == NULL || *v == 0)
+        return defaultValue;
+    return v;
+}
+
+} // namespace cpu
@@ -0,0 +1,89 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CPU_H_
+#define CPU_H_
+
+#include <stdint.h>
+
+/* host cpu - the firmware runs as a native (linux) process
+ *
+ * there are no real interrupts: the timers ("interrupt handlers") run on
+ * a virtual clock, they are called at poll points:
+ *  - at the end of an ATOMIC_BLOCK (when the interrupts are enabled again),
+ *  - in Utils::delayMicroseconds()
+ * every poll point advances the clock by CPU_POLL_PERIOD_NS, so the main
+ * loop runs much faster than real time and the results are repeatable.
+ * When the firmware is idle (Time::delay, see waitForInterrupt()) the clock
+ * jumps straight to the next timer deadline.
+ *
+ * environment variables:
+ *  CHEALI_EEPROM       eeprom file (default: eeprom.bin)
+ *  CHEALI_SERIAL       serial output, a file or a pipe (default: none)
+ *  CHEALI_LCD          1: draw the LCD on stdout
+ *                      (default: 1 if stdout is a terminal)
+ *  CHEALI_REALTIME     1: don't run ahead of the wall clock
+ *                      (default: 1 if stdin is a terminal)
+ *  CHEALI_TIME_LIMIT   exit after n seconds of virtual time
+ *  CHEALI_ISR_STATS    handler time statistics (see IsrStats.h)
+ *  CHEALI_BENCH        microbenchmarks (see Benchmark.h)
+ *  CHEALI_PLANT        simulated battery (see generic/50W/Plant.h)
+ *  CHEALI_REPLAY       serial log replay (see generic/50W/Replay.h)
+ *  CHEALI_FUZZ         1: stdin is the fuzz input, not the keyboard, and the
+ *                      eeprom is read only (see generic/50W/Fuzz.h)
+ *  CHEALI_SCENARIO     run a program on the Plant, report and exit
+ *                      (see generic/50W/Scenario.h)
+ */
+
+#ifndef CPU_POLL_PERIOD_NS
+#define CPU_POLL_PERIOD_NS      1000
+#endif
+
+namespace cpu {
+    void init();
+
+    typedef void (*Interrupt)();
+
+    enum Timer {
+        Timer0,
+        TimerADC,
+        TimerTerminal,
+        //Plant or Replay
+        TimerPlant,
+        TimerFuzz,
+        TIMERS
+    };
+
+    //the handler is called after delayNs and then every periodNs (0 - once)
+    void startTimer(uint8_t timer, Interrupt handler, uint32_t delayNs, uint32_t periodNs = 0);
+    void stopTimer(uint8_t timer);
+
+    uint64_t getNanoseconds();
+    bool inInterrupt();
+    bool isFuzzing();
+
+    //poll point: advance the clock, call the due handlers
+    void poll();
+    //busy wait
+    void delay(uint32_t ns);
+    //idle: jump to the next timer deadline and call the handlers
+    void waitForInterrupt();
+
+    const char * getEnv(const char * name, const char * defaultValue);
+}
+
+#endif /* CPU_H_ */
@@ -0,0 +1,59 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "memory.h"
+#include "eeprom.h"
+#include "cpu.h"
+
+namespace eeprom {
+
+namespace {
+    int fd_ = -1;
+}
+
+void load()
+{
+    //fuzzing: every run starts from the same eeprom
+    if(cpu::isFuzzing())
+        fd_ = open(cpu::getEnv("CHEALI_EEPROM", "eeprom.bin"), O_RDONLY);
+    else
+        fd_ = open(cpu::getEnv("CHEALI_EEPROM", "eeprom.bin"), O_RDWR | O_CREAT, 0644);
+    if(fd_ < 0)
+        return;
+    //a new (or shorter) file reads as zeros, eeprom::check() restores the defaults
+    if(pread(fd_, &data, sizeof(data), 0) != (ssize_t) sizeof(data)) {
+        std::memset(&data, 0, sizeof(data));
+    }
+    if(!cpu::isFuzzing() && ftruncate(fd_, sizeof(data))) {}
+}
+
+void write_impl(uint8_t * addressE, const uint8_t * data, int size)
+{
+    if(std::memcmp(addressE, data, size) == 0)
+        return;
+
+    std::memcpy(addressE, data, size);
+    if(fd_ >= 0 && !cpu::isFuzzing()) {
+        off_t offset = addressE - (uint8_t *) &eeprom::data;
+        if(pwrite(fd_, addressE, size, offset)) {}
+    }
+}
+
+} // namespace eeprom
@@ -0,0 +1,282 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "atomic.h"
+#include "Hardware.h"
+#include "SMPS_PID.h"
+#include "Utils.h"
+#include "AnalogInputsPrivate.h"
+#include "SMPS.h"
+#include "Discharger.h"
+#include "cpu.h"
+#include "IsrStats.h"
+#include "AnalogInputsADCSchedule.h"
+#include "AnalogInputsADCTrigger.h"
+#include "outputPWM.h"
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+#include "AnalogInputsNoise.h"
+#endif
+
+/* host ADC:
+ * the same ADC schedule as on the nuvoton, every conversion (burst_ samples)
+ * is one TimerADC interrupt on the virtual clock.
+ * There is no multiplexer, the samples are taken from in-memory
+ * registers - one per input (see setInput()).
+ * The SMPS current ripple (setRipple()) is a triangle in phase with the
+ * PWM (see AnalogInputsADCTrigger.h), the free running samples are taken
+ * every ADC_SAMPLE_TIME_NS, the sync_ ones at the trigger point.
+ */
+
+//~27 ADC clocks at 4MHz
+#define ADC_SAMPLE_TIME_NS  6750
+
+
+namespace AnalogInputsADC {
+
+static uint8_t current_input_;
+static bool addSumToInput_;
+static uint16_t input_[AnalogInputs::PHYSICAL_INPUTS];
+static uint16_t forced_[AnalogInputs::PHYSICAL_INPUTS];
+static uint16_t ripple_[AnalogInputs::PHYSICAL_INPUTS];
+static uint64_t conversionStart_;
+static uint32_t forcedMask_;
+static uint8_t noise_;
+static uint32_t noiseSeed_ = 1;
+
+
+//keep in sync with nuvoton-NUC029/generic/50W/AnalogInputsADC.cpp
+struct adc_inputs {
+    static constexpr adc_input list[] = {
+        //mux_,                         adc_pin_,               ai_name_,                       trigger_PID_, weight_, burst_, scale_, trim_, sync_
+        {MADDR_V_BALANSER_BATT_MINUS,   MUX0_Z_D_PIN,           AnalogInputs::Vb0_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER_BATT_MINUS,   MUX0_Z_D_PIN,           AnalogInputs::Vout_minus_pin,   false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER1,             MUX0_Z_D_PIN,           AnalogInputs::Vb1_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER2,             MUX0_Z_D_PIN,           AnalogInputs::Vb2_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_OUTPUT_VOLTAGE_PLUS_PIN, MUX0_Z_D_PIN,         AnalogInputs::Vout_plus_pin,    false,  1,  70, 1, true, false},
+        {MADDR_V_BALANSER6,             MUX0_Z_D_PIN,           AnalogInputs::Vb6_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER5,             MUX0_Z_D_PIN,           AnalogInputs::Vb5_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER4,             MUX0_Z_D_PIN,           AnalogInputs::Vb4_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER3,             MUX0_Z_D_PIN,           AnalogInputs::Vb3_pin,          false,  1,  70, 1, false, false},
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+        {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,            true,   8,  14, ANALOG_INPUTS_ADC_SCALE_Ismps, false, true},
+#else
+        {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,            true,   8,  70, ANALOG_INPUTS_ADC_SCALE_Ismps, true, false},
+#endif
+        {-1,                            DISCHARGE_CURRENT_PIN,  AnalogInputs::Idischarge,       false,  1,  70, 1, false, false},
+        {-1,                            V_IN_PIN,               AnalogInputs::Vin,              false,  1,  14, 1, false, false},
+        {-1,                            T_EXTERNAL_PIN,         AnalogInputs::Textern,          false,  1,  70, 1, false, false},
+        {-1,                            T_INTERNAL_PIN,         AnalogInputs::Tintern,          false,  1,  14, 1, false, false},
+    };
+};
+constexpr adc_input adc_inputs::list[];
+
+typedef AdcSchedule<adc_inputs> schedule_;
+
+
+inline uint8_t nextInput(uint8_t i) {
+    i++;
+    if(i >= schedule_::SLOTS) i=0;
+    return i;
+}
+
+inline uint16_t getPWMClock(uint64_t ns) {
+    return (ns / ADC_TRIGGER_PWM_CLOCK_NS) % (OUTPUT_PWM_PERIOD + 1);
+}
+
+//ripple: down from +ripple_/2 during the off time, up during the on time
+inline int32_t getRipple(AnalogInputs::Name name, uint16_t clock, uint16_t cmr) {
+    int32_t r = ripple_[name];
+    if(r == 0)
+        return 0;
+    int32_t off = cmr < OUTPUT_PWM_PERIOD ? OUTPUT_PWM_PERIOD - cmr : 0;
+    if(clock < off)
+        return r/2 - r*clock/off;
+    return r*(clock - off)/(OUTPUT_PWM_PERIOD + 1 - off) - r/2;
+}
+
+//uniform noise: +/- noise_ LSB
+inline uint16_t getSample(AnalogInputs::Name name, uint16_t clock, uint16_t cmr) {
+    int32_t v = (forcedMask_ & (1UL << name)) ? forced_[name] : input_[name] + getRipple(name, clock, cmr);
+    if(noise_) {
+        noiseSeed_ ^= noiseSeed_ << 13;
+        noiseSeed_ ^= noiseSeed_ >> 17;
+        noiseSeed_ ^= noiseSeed_ << 5;
+        v += int32_t(noiseSeed_ % (2*noise_ + 1)) - noise_;
+    }
+    if(v < 0) v = 0;
+    if(v > ANALOG_INPUTS_MAX_ADC_VALUE) v = ANALOG_INPUTS_MAX_ADC_VALUE;
+    return v;
+}
+
+void conversionDone();
+void finalizeMeasurement();
+
+void startConversion()
+{
+    const adc_correlation &c = schedule_::order[current_input_];
+    //sync_: one sample per PWM period
+    uint32_t sampleTime = c.sync_ ? (OUTPUT_PWM_PERIOD + 1) * ADC_TRIGGER_PWM_CLOCK_NS : ADC_SAMPLE_TIME_NS;
+    conversionStart_ = cpu::getNanoseconds();
+    cpu::startTimer(cpu::TimerADC, conversionDone, c.burst_ * sampleTime);
+}
+
+void conversionDone()
+{
+    const adc_correlation &c = schedule_::order[current_input_];
+    uint32_t sum = 0;
+    uint16_t v = 0, vMin = 0xffff, vMax = 0;
+    uint16_t cmr = outputPWM::getSmpsCMR();
+    AnalogInputsADCTrigger::Trigger trigger = AnalogInputsADCTrigger::get(cmr);
+    for(uint8_t i = 0; i < c.burst_; i++) {
+        uint16_t clock = c.sync_ ? AnalogInputsADCTrigger::getSampleClock(trigger, cmr)
+                : getPWMClock(conversionStart_ + i * ADC_SAMPLE_TIME_NS);
+        v = getSample(c.ai_name_, clock, cmr);
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+        AnalogInputsNoise::intterruptSample(c.ai_name_, v);
+#endif
+        sum += v;
+        if(v < vMin) vMin = v;
+        if(v > vMax) vMax = v;
+    }
+    if(c.trim_)
+        sum -= vMin + vMax;
+    // pretend 16bit adc
+    AnalogInputs::i_adc_[c.ai_name_] = v << 4;
+    if(addSumToInput_)
+        AnalogInputs::i_avrSum_[c.ai_name_] += sum << 4;
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+    if(c.ai_name_ <= AnalogInputs::Idischarge)
+        AnalogInputs::i_roundSum_[c.ai_name_] += sum << 4;
+#endif
+#ifdef ENABLE_DISCHARGER_PID
+    if(c.ai_name_ == AnalogInputs::Idischarge)
+        SMPS_PID::updateDischarger((sum << 4) / (c.burst_ - (c.trim_ ? 2 : 0)));
+#endif
+
+    current_input_ = nextInput(current_input_);
+
+    if(current_input_ == 0) {
+        finalizeMeasurement();
+        IsrStats::round();
+        addSumToInput_ = AnalogInputs::i_avrCount_ > 0;
+    }
+    startConversion();
+
+    if(schedule_::order[current_input_].trigger_PID_) {
+        uint64_t begin = IsrStats::begin();
+        SMPS_PID::update();
+        IsrStats::end(IsrStats::SectionPID, begin);
+    }
+}
+
+void finalizeMeasurement()
+{
+    AnalogInputs::i_adc_[AnalogInputs::IsmpsSet]        = SMPS::getValue();
+    AnalogInputs::i_adc_[AnalogInputs::IdischargeSet]   = Discharger::getValue();
+
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+    for(uint8_t i = 0; i < schedule_::INPUTS; i++) {
+        const adc_normalization &n = schedule_::normalize[i];
+        if(n.name_ <= AnalogInputs::Idischarge) {
+            uint32_t v = AnalogInputs::i_roundSum_[n.name_];
+            AnalogInputs::i_roundSum_[n.name_] = v / n.divider_ * n.multiplier_;
+        }
+    }
+    AnalogInputs::intterruptIntegrate();
+#endif
+
+    if(addSumToInput_) {
+        AnalogInputs::i_avrSum_[AnalogInputs::IsmpsSet]        += SMPS::getValue() * ANALOG_INPUTS_ADC_BURST_COUNT;
+        AnalogInputs::i_avrSum_[AnalogInputs::IdischargeSet]   += Discharger::getValue() * ANALOG_INPUTS_ADC_BURST_COUNT;
+        if(AnalogInputs::i_avrCount_ == 1) {
+            for(uint8_t i = 0; i < schedule_::INPUTS; i++) {
+                const adc_normalization &n = schedule_::normalize[i];
+                if(n.divider_ != 1 || n.multiplier_ != 1) {
+                    uint32_t v = AnalogInputs::i_avrSum_[n.name_];
+                    AnalogInputs::i_avrSum_[n.name_] = v / n.divider_ * n.multiplier_;
+                }
+            }
+        }
+        AnalogInputs::intterruptFinalizeMeasurement();
+    }
+}
+
+void setInput(AnalogInputs::Name name, uint16_t value)
+{
+    input_[name] = value;
+}
+
+uint16_t getInput(AnalogInputs::Name name)
+{
+    return input_[name];
+}
+
+void setNoise(uint8_t lsb)
+{
+    noise_ = lsb;
+}
+
+static uint16_t toInput(AnalogInputs::Name name, AnalogInputs::ValueType real)
+{
+    uint8_t scale = 1;
+    for(uint8_t i = 0; i < schedule_::INPUTS; i++) {
+        if(adc_inputs::list[i].ai_name_ == name)
+            scale = adc_inputs::list[i].scale_;
+    }
+    uint32_t v = AnalogInputs::reverseCalibrateValue(name, real);
+    v = (v + 8 * scale) / (16 * scale);
+    return v < ANALOG_INPUTS_MAX_ADC_VALUE ? v : ANALOG_INPUTS_MAX_ADC_VALUE;
+}
+
+void setReal(AnalogInputs::Name name, AnalogInputs::ValueType real)
+{
+    setInput(name, toInput(name, real));
+}
+
+void setRipple(AnalogInputs::Name name, AnalogInputs::ValueType real)
+{
+    uint16_t zero = toInput(name, 0), v = toInput(name, real);
+    ripple_[name] = v > zero ? v - zero : 0;
+}
+
+void forceInput(AnalogInputs::Name name, uint16_t value)
+{
+    forced_[name] = value < ANALOG_INPUTS_MAX_ADC_VALUE ? value : ANALOG_INPUTS_MAX_ADC_VALUE;
+    forcedMask_ |= 1UL << name;
+}
+
+void forceReal(AnalogInputs::Name name, AnalogInputs::ValueType real)
+{
+    forceInput(name, toInput(name, real));
+}
+
+void release(AnalogInputs::Name name)
+{
+    forcedMask_ &= ~(1UL << name);
+}
+
+void initialize()
+{
+    //an idle charger on a 12V supply
+    setReal(AnalogInputs::Vin, ANALOG_VOLT(12.0));
+    setReal(AnalogInputs::Tintern, ANALOG_CELCIUS(25.0));
+
+    current_input_ = 0;
+    startConversion();
+}
+
+} // namespace AnalogInputsADC
@@ -0,0 +1,41 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2013  Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ANALOG_INPUTS_ADC_H_
+#define ANALOG_INPUTS_ADC_H_
+
+#include "AnalogInputs.h"
+
+namespace AnalogInputsADC
+{
+    void initialize();
+
+    //host: the ADC registers (12 bit), one per physical input
+    void setInput(AnalogInputs::Name name, uint16_t value);
+    uint16_t getInput(AnalogInputs::Name name);
+    //set the register to what the calibration turns into "real"
+    void setReal(AnalogInputs::Name name, AnalogInputs::ValueType real);
+    void setNoise(uint8_t lsb);
+    //SMPS ripple (peak to peak) of the input, in phase with the PWM
+    void setRipple(AnalogInputs::Name name, AnalogInputs::ValueType real);
+    //fault injection: the ADC reads value instead of the register until released
+    void forceInput(AnalogInputs::Name name, uint16_t value);
+    void forceReal(AnalogInputs::Name name, AnalogInputs::ValueType real);
+    void release(AnalogInputs::Name name);
+};
+
+#endif /* ANALOG_INPUTS_ADC_H_ */
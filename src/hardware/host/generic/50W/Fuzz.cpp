@@ -0,0 +1,241 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "Fuzz.h"
+#include "Plant.h"
+#include "Hardware.h"
+#include "AnalogInputsADC.h"
+#include "Terminal.h"
+#include "Monitor.h"
+#include "Strategy.h"
+#include "SMPS.h"
+#include "Discharger.h"
+#include "ProgramData.h"
+#include "Program.h"
+#include "IO.h"
+#include "cpu.h"
+
+#define FUZZ_FRAME_NS               100000000
+#define FUZZ_MAX_INPUT              4096
+//2 minutes, the rest of the input is ignored
+#define FUZZ_MAX_FRAMES             1200
+#define FUZZ_DRAIN_FRAMES           200
+#define FUZZ_STOP_PERIOD_FRAMES     10
+//the time the Monitor has to react to a fault (a measurement takes ~1s)
+#define FUZZ_FAULT_MEASUREMENTS     4
+#define FUZZ_HANG_NS                10000000000ULL
+
+namespace Fuzz {
+
+namespace {
+    const char * const faultNames[FAULTS] = {
+        "Tintern", "Vin", "Textern", "Vout high", "Vout low", "balancer", "Iout"
+    };
+    const char keys[] = "s-+ ";
+
+    uint8_t input_[FUZZ_MAX_INPUT];
+    uint16_t size_, position_;
+    uint16_t frame_, wait_, drain_;
+    uint8_t faults_;
+    bool glitch_;
+    AnalogInputs::Name glitchName_;
+    //the measurement count since a fault (current) should have been caught
+    uint16_t faultSince_[FAULTS];
+    uint16_t currentSince_;
+    uint64_t keyboardRead_;
+
+    void fail(const char * what)
+    {
+        fprintf(stderr, "fuzz: %.1fs, input byte %u: %s (stop: %s)\n",
+                cpu::getNanoseconds() * 1e-9, position_, what,
+                Program::stopReason ? Program::stopReason : "-");
+        abort();
+    }
+
+    bool isOutputOn()
+    {
+        return !IO::digitalRead(OUTPUT_DISABLE_PIN)
+                && (!IO::digitalRead(SMPS_DISABLE_PIN) || !IO::digitalRead(DISCHARGE_DISABLE_PIN));
+    }
+
+    void forceBalancer(bool on)
+    {
+        for(uint8_t i = AnalogInputs::Vb0_pin; i <= AnalogInputs::Vb6_pin; i++) {
+            if(on) AnalogInputsADC::forceInput(AnalogInputs::Name(i), 0);
+            else AnalogInputsADC::release(AnalogInputs::Name(i));
+        }
+    }
+
+    void releaseFault(uint8_t f)
+    {
+        using namespace AnalogInputs;
+        switch(f) {
+        case FaultTintern:  AnalogInputsADC::release(Tintern); break;
+        case FaultVin:      AnalogInputsADC::release(Vin); break;
+        case FaultTextern:  AnalogInputsADC::release(Textern); break;
+        case FaultVoutHigh:
+        case FaultVoutLow:  AnalogInputsADC::release(Vout_plus_pin); break;
+        case FaultBalancer: forceBalancer(false); break;
+        case FaultIout:
+            AnalogInputsADC::release(Ismps);
+            AnalogInputsADC::release(Idischarge);
+            break;
+        }
+        faults_ &= ~(1 << f);
+    }
+
+    //every frame: the glitches are released, Strategy::maxI may change
+    void applyFaults()
+    {
+        using namespace AnalogInputs;
+        if(faults_ & (1 << FaultTintern))   AnalogInputsADC::forceReal(Tintern, ANALOG_CELCIUS(120));
+        if(faults_ & (1 << FaultVin))       AnalogInputsADC::forceReal(Vin, ANALOG_VOLT(5));
+        if(faults_ & (1 << FaultTextern))   AnalogInputsADC::forceReal(Textern, ANALOG_CELCIUS(120));
+        if(faults_ & (1 << FaultVoutHigh))  AnalogInputsADC::forceInput(Vout_plus_pin, ANALOG_INPUTS_MAX_ADC_VALUE);
+        if(faults_ & (1 << FaultVoutLow))   AnalogInputsADC::forceInput(Vout_plus_pin, 0);
+        if(faults_ & (1 << FaultBalancer))  forceBalancer(true);
+        if(faults_ & (1 << FaultIout)) {
+            AnalogInputsADC::forceReal(Ismps, Strategy::maxI + ANALOG_AMP(2.000));
+            AnalogInputsADC::forceReal(Idischarge, Strategy::maxI + ANALOG_AMP(2.000));
+        }
+    }
+
+    //faults the Monitor must turn into an error (in the current state)
+    bool mustCatch(uint8_t f)
+    {
+        switch(f) {
+#ifdef ENABLE_T_INTERNAL
+        case FaultTintern:  return true;
+#endif
+        case FaultVin:      return true;
+        case FaultTextern:  return ProgramData::battery.enable_externT;
+        case FaultVoutHigh: return true;
+        case FaultVoutLow:  return Discharger::isPowerOn();
+        case FaultBalancer: return Monitor::isBalancePortConnected;
+        case FaultIout:     return true;
+        default:            return false;
+        }
+    }
+
+    void execute(uint8_t c)
+    {
+        if(c < 0x80) {
+            wait_ = c;
+        } else if(c < 0xa0) {
+            Terminal::pressKey(keys[c & 3], c & 4);
+        } else if(c < 0xc0) {
+            uint8_t f = (c & 0x1f) % FAULTS;
+            //the same input
+            if(f == FaultVoutHigh) releaseFault(FaultVoutLow);
+            if(f == FaultVoutLow) releaseFault(FaultVoutHigh);
+            faults_ |= 1 << f;
+        } else if(c < 0xe0) {
+            uint8_t f = c & 0x1f;
+            for(uint8_t i = 0; i < FAULTS; i++) {
+                if(f >= FAULTS || f == i)
+                    releaseFault(i);
+            }
+        } else if(position_ < size_) {
+            glitchName_ = AnalogInputs::Name((c & 0x1f) % AnalogInputs::PHYSICAL_INPUTS);
+            AnalogInputsADC::forceInput(glitchName_, input_[position_++] << 4);
+            glitch_ = true;
+        }
+    }
+
+    void check()
+    {
+        char buf[80];
+        uint16_t count = AnalogInputs::getMeasurementCount();
+        bool program = Monitor::isPowerOn() && isOutputOn();
+
+        for(uint8_t f = 0; f < FAULTS; f++) {
+            if(!program || !(faults_ & (1 << f)) || !mustCatch(f)) {
+                faultSince_[f] = count;
+            } else if(uint16_t(count - faultSince_[f]) > FUZZ_FAULT_MEASUREMENTS) {
+                snprintf(buf, sizeof(buf), "fault %s: the output is still on", faultNames[f]);
+                fail(buf);
+            }
+        }
+
+        double limit = (Strategy::maxI + ANALOG_AMP(1.000)) / 1000.0;
+        if(!program || fabs(Plant::getCurrent()) <= limit) {
+            currentSince_ = count;
+        } else if(uint16_t(count - currentSince_) > FUZZ_FAULT_MEASUREMENTS) {
+            snprintf(buf, sizeof(buf), "output current %.3fA > %.3fA", fabs(Plant::getCurrent()), limit);
+            fail(buf);
+        }
+
+        if(cpu::getNanoseconds() - keyboardRead_ > FUZZ_HANG_NS)
+            fail("main loop: the keyboard is not read");
+    }
+
+    void doDrain()
+    {
+        if(drain_ == 0) {
+            for(uint8_t i = 0; i < FAULTS; i++)
+                releaseFault(i);
+        }
+        if(drain_ % FUZZ_STOP_PERIOD_FRAMES == 0)
+            Terminal::pressKey('s');
+        if(++drain_ < FUZZ_DRAIN_FRAMES)
+            return;
+        if(Monitor::isPowerOn() || isOutputOn())
+            fail("the program doesn't stop");
+        exit(0);
+    }
+}
+
+bool initialize()
+{
+    if(!cpu::isFuzzing())
+        return false;
+    ssize_t n;
+    while(size_ < FUZZ_MAX_INPUT && (n = read(0, input_ + size_, FUZZ_MAX_INPUT - size_)) > 0)
+        size_ += n;
+    keyboardRead_ = cpu::getNanoseconds();
+    cpu::startTimer(cpu::TimerFuzz, doInterrupt, FUZZ_FRAME_NS, FUZZ_FRAME_NS);
+    return true;
+}
+
+void doInterrupt()
+{
+    if(glitch_) {
+        AnalogInputsADC::release(glitchName_);
+        glitch_ = false;
+    }
+    if(frame_ >= FUZZ_MAX_FRAMES || (!wait_ && position_ >= size_)) {
+        doDrain();
+    } else {
+        frame_++;
+        if(wait_) wait_--;
+        else execute(input_[position_++]);
+    }
+    applyFaults();
+    check();
+}
+
+void keyboardRead()
+{
+    keyboardRead_ = cpu::getNanoseconds();
+}
+
+} // namespace Fuzz
@@ -0,0 +1,70 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef FUZZ_H_
+#define FUZZ_H_
+
+#include <stdint.h>
+
+/* host: fault injection fuzzer, CHEALI_FUZZ=1 (on top of the Plant)
+ *
+ * stdin is the fuzz input (AFL style), it is read at once, then one
+ * command per FUZZ_FRAME_NS (100ms):
+ *  0x00-0x7f   wait n more frames
+ *  0x80-0x9f   key: bits 0-1: stop, dec, inc, start; bit 2: long press
+ *  0xa0-0xbf   fault n % FAULTS on (see Fault)
+ *  0xc0-0xdf   fault n off, n >= FAULTS: all faults off
+ *  0xe0-0xff   glitch: the ADC reads the next byte (x16) on input n for one frame
+ * after the input (or FUZZ_MAX_FRAMES) all faults are released and STOP
+ * is pressed every second for FUZZ_DRAIN_FRAMES.
+ *
+ * invariants, a violation is written to stderr and abort()s:
+ *  - a fault the Monitor has to catch turns the output off within
+ *    FUZZ_FAULT_MEASUREMENTS measurements
+ *  - the output current (Plant) stays below Strategy::maxI + 1A
+ *    (the Monitor limit) for the same time
+ *  - the main loop reads the keyboard at least every FUZZ_HANG_NS
+ *  - the output is off and the program ended after the drain
+ * the faults are checked only during a program (Monitor on).
+ *
+ * the eeprom is read only, so every run starts from the same settings, e.g.:
+ *  printf '\x22\x82\x05\x83\x14\x83\x1e\x87\x64' > seeds/charge   (battery 1: charge)
+ *  CHEALI_FUZZ=1 CHEALI_EEPROM=lipo3s.bin afl-fuzz -i seeds -o out -- ./cheali-charger
+ */
+
+namespace Fuzz {
+    enum Fault {
+        FaultTintern,       //120C
+        FaultVin,           //5V
+        FaultTextern,       //120C, if enabled
+        FaultVoutHigh,      //ADC max
+        FaultVoutLow,       //0V, battery disconnected (discharge)
+        FaultBalancer,      //balance port disconnected
+        FaultIout,          //Strategy::maxI + 2A
+        FAULTS
+    };
+
+    //false: not enabled
+    bool initialize();
+
+    //TimerFuzz handler
+    void doInterrupt();
+    //the main loop is alive
+    void keyboardRead();
+}
+
+#endif /* FUZZ_H_ */
@@ -0,0 +1,79 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2013  Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HARDWARE_CONFIG_GENERIC_H_
+#define HARDWARE_CONFIG_GENERIC_H_
+
+
+#include "AnalogInputsTypes.h"
+
+#define MAX_BALANCE_CELLS       6
+
+#define CALIBRATION_CHARGE_POINT0_mA    100
+#define CALIBRATION_CHARGE_POINT1_mA    1000
+#define CALIBRATION_DISCHARGE_POINT0_mA 100
+#define CALIBRATION_DISCHARGE_POINT1_mA 300
+
+#define ENABLE_SIMPLIFIED_VB0_VB2_CIRCUIT
+//TODO: should be implemented!
+//when the imaxB6 discharges, the voltage on Vb0_pin
+//(Vb0_pin = VBATT- on the balance port)
+//drops below 0V so the ADC doesn't see it.
+//This is why we see a bigger Vb1 resistance.
+#define ENABLE_B0_DISCHARGE_VOLTAGE_CORRECTION
+
+//#define ENABLE_EXT_TEMP_AND_UART_COMMON_OUTPUT
+
+#define ENABLE_GET_PID_VALUE
+//preload the SMPS PID on a setpoint change, no current ramp (see SMPS_PID.cpp)
+#define ENABLE_SMPS_FEED_FORWARD
+//second order noise shaping of the PWM modulator, optional dither (see outputPWMModulator.h)
+#define ENABLE_OUTPUT_PWM_NOISE_SHAPING
+//#define ENABLE_OUTPUT_PWM_DITHER
+//hold the measured discharge current (see SMPS_PID.h)
+#define ENABLE_DISCHARGER_PID
+//Ismps: one sample per PWM period, in the middle of the current ramp (see AnalogInputsADCTrigger.h)
+#define ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+#define ENABLE_EXPERT_VOLTAGE_CALIBRATION
+#define ENABLE_T_INTERNAL
+
+#define DEFAULT_SETTINGS_EXTERNAL_T 0
+
+#define ANALOG_INPUTS_ADC_BURST_COUNT           70
+#define ANALOG_INPUTS_ADC_ROUND_MAX_COUNT       100
+#define ANALOG_INPUTS_ADC_RESOLUTION_BITS       12
+//host: the interrupts run only at poll points (see cpu.h)
+#define ENABLE_ATOMIC_32BIT_READ
+//host: Time::delay jumps the virtual clock to the next timer deadline
+#define ENABLE_TIME_WAIT_FOR_INTERRUPT
+//host: no ADC range limit, Ismps and the PID share one scale (see Plant.cpp)
+#define ANALOG_INPUTS_ADC_SCALE_Ismps           1
+//integrate charge and energy after every ADC round
+#define ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+
+//#define ANALOG_INPUTS_MAX_ADC_Vout_plus_pin (ANALOG_INPUTS_MAX_ADC_VALUE/2)
+#define ANALOG_INPUTS_MAX_ADC_Vout_plus_pin 25000
+
+#define CHEALI_CHARGER_ARCHITECTURE_GENERIC             1
+#define CHEALI_CHARGER_ARCHITECTURE_GENERIC_STRING      "host-50W"
+
+#define LCD_BACKLIGHT_MIN       100
+#define LCD_BACKLIGHT_MAX       32000
+#define ENABLE_LCD_BACKLIGHT
+//#define ENABLE_FAN
+
+#endif /* HARDWARE_CONFIG_GENERIC_H_ */
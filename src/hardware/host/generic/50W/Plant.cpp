@@ -0,0 +1,445 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Plant.h"
+#include "Hardware.h"
+#include "AnalogInputsADC.h"
+#include "AnalogInputsADCTrigger.h"
+#include "outputPWM.h"
+#include "IO.h"
+#include "Monitor.h"
+#include "Utils.h"
+#include "cpu.h"
+
+#define PLANT_STEP_NS                   500000
+//cell voltages and temperatures are written every n steps
+#define PLANT_SLOW_STEPS                20
+#define PLANT_SMPS_TIME_CONSTANT_NS     1000000
+#define PLANT_SMPS_RESISTANCE           0.100
+#define PLANT_LEAD_RESISTANCE           0.020
+#define PLANT_BALANCER_RESISTANCE       20.0
+#define PLANT_MAX_BOOST                 0.9
+#define PLANT_PWM_PERIOD_S              ((OUTPUT_PWM_PERIOD + 1) * ADC_TRIGGER_PWM_CLOCK_NS * 1e-9)
+//thermal: per cell
+#define PLANT_HEAT_CAPACITY             50.0    // J/K
+#define PLANT_THERMAL_RESISTANCE        20.0    // K/W
+#define PLANT_CHARGER_THERMAL_RESISTANCE 4.0    // K/W, 10% loss
+#define PLANT_DISCHARGER_TIME_CONSTANT  60.0    // s, the discharger transistor and its heatsink
+//report after the output is idle for
+#define PLANT_IDLE_REPORT_NS            30000000000ULL
+#define PLANT_CV_TIME_CONSTANT          10.0    // s
+#define PLANT_MIN_CURRENT               0.010   // A
+//without a balance port (NiMH, Pb)
+#define PLANT_MAX_CELLS                 16
+
+namespace Plant {
+
+namespace {
+    struct Cell {
+        double soc;         //0 - 1
+        double capacity;    //As
+        double vrc;
+        double v;           //terminal voltage
+    };
+
+    struct Chemistry {
+        const char * name;
+        ProgramData::BatteryType type;
+        //open circuit voltage, SoC 0%, 10%, ... 100%
+        double ocv[11];
+        //the charge acceptance drops linearly from this SoC to 0 at 100%,
+        //the rest of the current is heat (NiMH: -dV, dT)
+        double acceptance;
+        double temperatureCoefficient;  // V/K
+        bool balancePort;
+    };
+
+    const Chemistry chemistries[] = {
+        {"lipo", ProgramData::Lipo, {3.000, 3.680, 3.740, 3.770, 3.790, 3.820, 3.870, 3.920, 3.980, 4.060, 4.200}, 1,   0,      true},
+        {"life", ProgramData::Life, {2.500, 3.000, 3.150, 3.220, 3.250, 3.270, 3.290, 3.300, 3.320, 3.360, 3.600}, 1,   0,      true},
+        {"nimh", ProgramData::NiMH, {1.000, 1.200, 1.240, 1.260, 1.270, 1.280, 1.290, 1.310, 1.330, 1.370, 1.450}, 0.8, -0.003, false},
+        //the voltage near 100% includes the polarization at the end of charge
+        {"pb",   ProgramData::Pb,   {1.750, 1.930, 1.960, 1.980, 2.000, 2.020, 2.040, 2.070, 2.110, 2.200, 2.450}, 1,   0,      false},
+    };
+
+    const Chemistry * chemistry_ = &chemistries[0];
+    Cell cells_[PLANT_MAX_CELLS];
+    uint8_t cellCount_ = 3;
+    bool balancePort_ = true;
+    double capacity_ = 2000, soc_ = 20, imbalance_ = 1, spread_ = 2;
+    double r0_ = 0.015, r1_ = 0.010, c1_ = 2000;
+    double vin_ = 12, ambient_ = 25, l_ = 0;
+    double dgain_ = 0, dtc_ = 0;
+    int noise_ = 1;
+    uint32_t seed_ = 1;
+    bool exit_ = false;
+    bool noBalancePort_ = false;
+
+    double iSmps_, iDischarge_;
+    double temperature_, chargerTemperature_, dischargerTemperature_;
+    uint8_t slowStep_;
+
+    //report
+    bool session_;
+    uint64_t start_, lastCharge_, cvStart_, idle_;
+    double iSlow_, iPeak_, charged_, discharged_, maxTemperature_;
+    double energyIn_, energyOut_;
+
+    double random()
+    {
+        //xorshift32
+        seed_ ^= seed_ << 13;
+        seed_ ^= seed_ >> 17;
+        seed_ ^= seed_ << 5;
+        return double(seed_) / 4294967296.0;
+    }
+
+    double gauss()
+    {
+        return (random() + random() + random() + random() - 2) * sqrt(3.0);
+    }
+
+    double getOCV(double soc)
+    {
+        const double * ocv = chemistry_->ocv;
+        double v;
+        if(soc <= 0) {
+            v = ocv[0];
+        } else if(soc >= 1) {
+            //overcharge: 30mV per %
+            v = ocv[10] + (soc - 1) * 3;
+        } else {
+            double x = soc * 10;
+            int i = int(x);
+            v = ocv[i] + (ocv[i+1] - ocv[i]) * (x - i);
+        }
+        return v + chemistry_->temperatureCoefficient * (temperature_ - ambient_);
+    }
+
+    //the part of the charge current that is stored
+    double getAcceptance(double soc)
+    {
+        double a = chemistry_->acceptance;
+        if(a >= 1 || soc <= a) return 1;
+        if(soc >= 1) return 0;
+        return (1 - soc) / (1 - a);
+    }
+
+    void setChemistry(const char * name)
+    {
+        for(uint8_t i = 0; i < sizeOfArray(chemistries); i++) {
+            if(!strcmp(name, chemistries[i].name)) {
+                chemistry_ = &chemistries[i];
+                return;
+            }
+        }
+        fprintf(stderr, "plant: unknown chemistry: %s\n", name);
+    }
+
+    void parseConfig(const char * config)
+    {
+        char buf[256];
+        strncpy(buf, config, sizeof(buf) - 1);
+        buf[sizeof(buf) - 1] = 0;
+        for(char * p = strtok(buf, ","); p; p = strtok(NULL, ",")) {
+            char * v = strchr(p, '=');
+            if(!v) continue;
+            *v++ = 0;
+            if(!strcmp(p, "chem")) {
+                setChemistry(v);
+                continue;
+            }
+            double x = atof(v);
+            if(!strcmp(p, "cells"))             cellCount_ = x < PLANT_MAX_CELLS ? x : PLANT_MAX_CELLS;
+            else if(!strcmp(p, "capacity"))     capacity_ = x;
+            else if(!strcmp(p, "soc"))          soc_ = x;
+            else if(!strcmp(p, "imbalance"))    imbalance_ = x;
+            else if(!strcmp(p, "spread"))       spread_ = x;
+            else if(!strcmp(p, "r0"))           r0_ = x / 1000;
+            else if(!strcmp(p, "r1"))           r1_ = x / 1000;
+            else if(!strcmp(p, "c1"))           c1_ = x;
+            else if(!strcmp(p, "vin"))          vin_ = x / 1000;
+            else if(!strcmp(p, "ambient"))      ambient_ = x;
+            else if(!strcmp(p, "noise"))        noise_ = x;
+            else if(!strcmp(p, "l"))            l_ = x * 1e-6;
+            else if(!strcmp(p, "dgain"))        dgain_ = x;
+            else if(!strcmp(p, "dtc"))          dtc_ = x;
+            else if(!strcmp(p, "seed"))         seed_ = x ? x : 1;
+            else if(!strcmp(p, "exit"))         exit_ = x;
+            else if(!strcmp(p, "balance"))      noBalancePort_ = !x;
+            else fprintf(stderr, "plant: unknown option: %s\n", p);
+        }
+    }
+
+    uint8_t getBalancer()
+    {
+        if(!balancePort_)
+            return 0;
+        static const uint8_t pins[] = {BALANCER1_LOAD_PIN, BALANCER2_LOAD_PIN, BALANCER3_LOAD_PIN,
+                BALANCER4_LOAD_PIN, BALANCER5_LOAD_PIN, BALANCER6_LOAD_PIN};
+        uint8_t v = 0;
+        for(uint8_t i = 0; i < MAX_BALANCE_CELLS; i++)
+            if(IO::digitalRead(pins[i])) v |= 1 << i;
+        return v;
+    }
+
+    void setVoltage(AnalogInputs::Name name, double v)
+    {
+        AnalogInputsADC::setReal(name, v > 0 ? ANALOG_VOLT(v) : 0);
+    }
+
+    void writeSlowInputs()
+    {
+        double sum = 0;
+        for(uint8_t i = 0; i < MAX_BALANCE_CELLS; i++) {
+            double v = balancePort_ ? cells_[i].v : 0;
+            //Vb0_pin, Vb1_pin, Vb2_pin: to ground, see ENABLE_SIMPLIFIED_VB0_VB2_CIRCUIT
+            if(i < 2) v += sum;
+            sum += balancePort_ ? cells_[i].v : 0;
+            setVoltage(AnalogInputs::Name(AnalogInputs::Vb1_pin + i), v);
+        }
+        setVoltage(AnalogInputs::Vb0_pin, 0);
+        setVoltage(AnalogInputs::Vout_minus_pin, 0);
+        setVoltage(AnalogInputs::Vin, vin_);
+        AnalogInputsADC::setReal(AnalogInputs::Textern, ANALOG_CELCIUS(temperature_));
+        AnalogInputsADC::setReal(AnalogInputs::Tintern, ANALOG_CELCIUS(chargerTemperature_));
+    }
+
+    void updateReport(bool batteryOn, double iCharge, bool balancing, double vBattery)
+    {
+        uint64_t now = cpu::getNanoseconds();
+        double dt = PLANT_STEP_NS * 1e-9;
+        bool active = iCharge > PLANT_MIN_CURRENT || iDischarge_ > PLANT_MIN_CURRENT || balancing;
+
+        if(!session_) {
+            if(!active || !batteryOn)
+                return;
+            session_ = true;
+            start_ = lastCharge_ = cvStart_ = 0;
+            iSlow_ = iPeak_ = charged_ = discharged_ = 0;
+            energyIn_ = energyOut_ = 0;
+            maxTemperature_ = temperature_;
+        }
+
+        iSlow_ += (iCharge - iSlow_) * dt / PLANT_CV_TIME_CONSTANT;
+        charged_ += iCharge * dt;
+        discharged_ += iDischarge_ * dt;
+        energyIn_ += iCharge * vBattery * dt;
+        energyOut_ += iDischarge_ * vBattery * dt;
+        if(temperature_ > maxTemperature_)
+            maxTemperature_ = temperature_;
+
+        if(iCharge > PLANT_MIN_CURRENT) {
+            if(!start_) start_ = now;
+            lastCharge_ = now;
+        }
+        if(iSlow_ > iPeak_) {
+            iPeak_ = iSlow_;
+            cvStart_ = 0;
+        } else if(!cvStart_ && iSlow_ < iPeak_ * 0.9) {
+            cvStart_ = now;
+        }
+
+        //a program (e.g. D/C cycle rest time) is not split
+        if(active || Monitor::isPowerOn()) idle_ = now;
+        if(!batteryOn || now - idle_ >= PLANT_IDLE_REPORT_NS) {
+            report();
+            session_ = false;
+            if(exit_)
+                exit(0);
+        }
+    }
+}
+
+void initialize()
+{
+    parseConfig(cpu::getEnv("CHEALI_PLANT", ""));
+
+    balancePort_ = chemistry_->balancePort && cellCount_ <= MAX_BALANCE_CELLS && !noBalancePort_;
+    temperature_ = chargerTemperature_ = dischargerTemperature_ = ambient_;
+    for(uint8_t i = 0; i < PLANT_MAX_CELLS; i++) {
+        Cell &c = cells_[i];
+        memset(&c, 0, sizeof(c));
+        if(i >= cellCount_)
+            continue;
+        c.soc = (soc_ + gauss() * imbalance_) / 100;
+        if(c.soc < 0) c.soc = 0;
+        c.capacity = capacity_ * 3.6 * (1 + gauss() * spread_ / 100);
+        c.v = getOCV(c.soc);
+    }
+    AnalogInputsADC::setNoise(noise_);
+    writeSlowInputs();
+
+    cpu::startTimer(cpu::TimerPlant, doInterrupt, PLANT_STEP_NS, PLANT_STEP_NS);
+}
+
+void doInterrupt()
+{
+    static const double dt = PLANT_STEP_NS * 1e-9;
+    static const double smpsK = 1 - exp(-double(PLANT_STEP_NS) / PLANT_SMPS_TIME_CONSTANT_NS);
+
+    bool batteryOn = cellCount_ > 0 && !IO::digitalRead(OUTPUT_DISABLE_PIN);
+    bool smpsOn = batteryOn && !IO::digitalRead(SMPS_DISABLE_PIN);
+    bool dischargerOn = batteryOn && !IO::digitalRead(DISCHARGE_DISABLE_PIN);
+
+    double emf = 0;
+    for(uint8_t i = 0; i < cellCount_; i++)
+        emf += getOCV(cells_[i].soc) + cells_[i].vrc;
+
+    //SMPS: buck (SMPS_VALUE_BUCK_PIN), then boost (SMPS_VALUE_BOOST_PIN)
+    double target = 0, ripple = 0;
+    if(smpsOn) {
+        double buck = double(outputPWM::getPWM(SMPS_VALUE_BUCK_PIN)) / OUTPUT_PWM_PRECISION_PERIOD;
+        double boost = double(outputPWM::getPWM(SMPS_VALUE_BOOST_PIN)) / OUTPUT_PWM_PRECISION_PERIOD;
+        if(boost > PLANT_MAX_BOOST) boost = PLANT_MAX_BOOST;
+        double v = vin_ * buck / (1 - boost);
+        target = (v - emf) / (cellCount_ * r0_ + PLANT_SMPS_RESISTANCE + PLANT_LEAD_RESISTANCE);
+        if(target < 0) target = 0;
+        //inductor ripple: buck - Vout * (1 - D) * T / L, boost - Vin * D * T / L
+        if(l_ > 0)
+            ripple = (boost > 0 ? vin_ * boost : v * (1 - buck)) * PLANT_PWM_PERIOD_S / l_;
+    }
+    //SMPS_DISABLE_PIN and OUTPUT_DISABLE_PIN cut the current at once
+    if(smpsOn)
+        iSmps_ += (target - iSmps_) * smpsK;
+    else
+        iSmps_ = 0;
+
+    //discharger: the PWM sets the current (IdischargeSet)
+    iDischarge_ = 0;
+    if(dischargerOn && !smpsOn) {
+        uint32_t pwm = outputPWM::getPWM(DISCHARGE_VALUE_PIN);
+        iDischarge_ = AnalogInputs::calibrateValue(AnalogInputs::IdischargeSet, pwm) / 1000.0;
+        //calibration error and temperature drift
+        iDischarge_ *= (1 + dgain_ / 100) * (1 + dtc_ / 100 * (dischargerTemperature_ - ambient_));
+        if(iDischarge_ < 0) iDischarge_ = 0;
+        double max = emf / (cellCount_ * r0_ + PLANT_LEAD_RESISTANCE + 0.5);
+        if(iDischarge_ > max) iDischarge_ = max;
+    }
+
+    uint8_t balancer = getBalancer();
+    double heat = 0, vout = 0;
+    for(uint8_t i = 0; i < cellCount_; i++) {
+        Cell &c = cells_[i];
+        double ocv = getOCV(c.soc);
+        double I = iSmps_ - iDischarge_;
+        if(balancer & (1 << i))
+            I -= (ocv + c.vrc) / PLANT_BALANCER_RESISTANCE;
+        double stored = I > 0 ? I * getAcceptance(c.soc) : I;
+        c.soc += stored * dt / c.capacity;
+        if(c.soc < 0) c.soc = 0;
+        c.vrc += (I / c1_ - c.vrc / (r1_ * c1_)) * dt;
+        c.v = ocv + c.vrc + I * r0_;
+        vout += c.v;
+        heat += I * I * r0_ + c.vrc * c.vrc / r1_ + (I - stored) * ocv;
+    }
+    if(cellCount_) {
+        temperature_ += (heat - (temperature_ - ambient_) * cellCount_ / PLANT_THERMAL_RESISTANCE)
+                * dt / (PLANT_HEAT_CAPACITY * cellCount_);
+    }
+    double loss = 0.1 * (iSmps_ + iDischarge_) * vout;
+    chargerTemperature_ = ambient_ + loss * PLANT_CHARGER_THERMAL_RESISTANCE;
+    //the discharger burns all of its power
+    dischargerTemperature_ += (ambient_ + iDischarge_ * vout * PLANT_CHARGER_THERMAL_RESISTANCE - dischargerTemperature_)
+            * dt / PLANT_DISCHARGER_TIME_CONSTANT;
+
+    double vBattery = vout;
+    //the battery stays connected to the output, OUTPUT_DISABLE_PIN only switches the current
+    vout += (iSmps_ - iDischarge_) * PLANT_LEAD_RESISTANCE;
+    setVoltage(AnalogInputs::Vout_plus_pin, vout);
+    AnalogInputsADC::setReal(AnalogInputs::Ismps, ANALOG_AMP(iSmps_));
+    //discontinuous below ripple/2: the ripple is limited to the average current
+    if(ripple > 2 * iSmps_) ripple = 2 * iSmps_;
+    AnalogInputsADC::setRipple(AnalogInputs::Ismps, ANALOG_AMP(ripple));
+    AnalogInputsADC::setReal(AnalogInputs::Idischarge, ANALOG_AMP(iDischarge_));
+
+    if(++slowStep_ >= PLANT_SLOW_STEPS) {
+        slowStep_ = 0;
+        writeSlowInputs();
+    }
+
+    updateReport(batteryOn, iSmps_, balancer != 0, vBattery);
+}
+
+double getCurrent()
+{
+    return iSmps_ - iDischarge_;
+}
+
+ProgramData::BatteryType getBatteryType()
+{
+    return chemistry_->type;
+}
+
+uint8_t getCells()
+{
+    return cellCount_;
+}
+
+uint16_t getCapacity()
+{
+    return capacity_;
+}
+
+void getResult(Result &r)
+{
+    r.charged = charged_ / 3.6;
+    r.discharged = discharged_ / 3.6;
+    r.energyIn = energyIn_ / 3600;
+    r.energyOut = energyOut_ / 3600;
+    double minOcv = 100, maxOcv = 0, minSoc = 100, maxSoc = 0;
+    for(uint8_t i = 0; i < cellCount_; i++) {
+        double ocv = getOCV(cells_[i].soc), soc = cells_[i].soc * 100;
+        if(ocv < minOcv) minOcv = ocv;
+        if(ocv > maxOcv) maxOcv = ocv;
+        if(soc < minSoc) minSoc = soc;
+        if(soc > maxSoc) maxSoc = soc;
+    }
+    r.ocvSpread = cellCount_ ? (maxOcv - minOcv) * 1000 : 0;
+    r.socSpread = cellCount_ ? maxSoc - minSoc : 0;
+    r.maxTemperature = session_ ? maxTemperature_ : temperature_;
+}
+
+void report()
+{
+    if(!session_)
+        return;
+    double minSoc = 100, maxSoc = 0, sumSoc = 0, minOcv = 10, maxOcv = 0;
+    for(uint8_t i = 0; i < cellCount_; i++) {
+        double soc = cells_[i].soc * 100, ocv = getOCV(cells_[i].soc);
+        if(soc < minSoc) minSoc = soc;
+        if(soc > maxSoc) maxSoc = soc;
+        if(ocv < minOcv) minOcv = ocv;
+        if(ocv > maxOcv) maxOcv = ocv;
+        sumSoc += soc;
+    }
+    double toFull = start_ ? (lastCharge_ - start_) * 1e-9 : 0;
+    double cvTail = cvStart_ && cvStart_ < lastCharge_ ? (lastCharge_ - cvStart_) * 1e-9 : 0;
+
+    fprintf(stderr, "plant: %s %uS %.0fmAh: time to full %.1fs, CV tail %.1fs, charged %.0fmAh %.2fWh, discharged %.0fmAh %.2fWh\n",
+            chemistry_->name, cellCount_, capacity_, toFull, cvTail,
+            charged_ / 3.6, energyIn_ / 3600, discharged_ / 3.6, energyOut_ / 3600);
+    fprintf(stderr, "plant: SoC min/mean/max %.2f/%.2f/%.2f%%, OCV min/max %.4f/%.4fV, T max %.1fC\n",
+            minSoc, cellCount_ ? sumSoc / cellCount_ : 0, maxSoc, minOcv, maxOcv, maxTemperature_);
+}
+
+} // namespace Plant
@@ -0,0 +1,77 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef PLANT_H_
+#define PLANT_H_
+
+#include <stdint.h>
+#include "ProgramData.h"
+
+/* host: simulated battery and power stage (closed loop)
+ *
+ *  - cells: OCV(SoC) curve + Thevenin network (R0, R1||C1),
+ *    random SoC and capacity spread (imbalance), thermal rise.
+ *    NiMH: the charge acceptance drops above 80% SoC, the rest is heat,
+ *    the OCV drops with the temperature (-dV)
+ *  - SMPS: the buck/boost PWM (SMPS_PID) drives the output voltage,
+ *    the current follows with PLANT_SMPS_TIME_CONSTANT_NS
+ *  - discharger: IdischargeSet PWM -> current, balancer: a resistor per cell
+ *  - the results are written to the ADC registers (AnalogInputsADC::setReal)
+ *
+ * configuration: CHEALI_PLANT="key=value,..." (default value):
+ *  chem (lipo) - lipo, life, nimh, pb,
+ *  cells (3, 0 - no battery), capacity [mAh] (2000), soc [%] (20),
+ *  imbalance [% SoC, sigma] (1), spread [% capacity, sigma] (2),
+ *  r0, r1 [mOhm per cell] (15, 10), c1 [F] (2000), vin [mV] (12000),
+ *  ambient [C] (25), noise [ADC LSB] (1), seed (1),
+ *  l [uH] (0) - the SMPS inductor, 0: no current ripple (see AnalogInputsADC),
+ *  dgain [%] (0), dtc [%/C] (0) - the discharger current error: calibration,
+ *      temperature drift (the discharger heats up with its power),
+ *  exit (0) - 1: exit after the first report,
+ *  balance (1) - 0: no balance port (always: nimh, pb, more than MAX_BALANCE_CELLS)
+ *
+ * a report is written to stderr when the output goes idle after a program
+ * (time to full, CV tail, charge, energy, final SoC/OCV per cell, temperature)
+ */
+
+namespace Plant {
+    void initialize();
+
+    //TimerPlant handler
+    void doInterrupt();
+    void report();
+
+    //the output current [A], discharge < 0
+    double getCurrent();
+
+    //the simulated battery
+    ProgramData::BatteryType getBatteryType();
+    uint8_t getCells();
+    uint16_t getCapacity();
+
+    //the current (or last) session, see report()
+    struct Result {
+        double charged, discharged;     //mAh
+        double energyIn, energyOut;     //Wh
+        double ocvSpread;               //mV, max - min cell OCV
+        double socSpread;               //%
+        double maxTemperature;          //C
+    };
+    void getResult(Result &r);
+}
+
+#endif /* PLANT_H_ */
@@ -0,0 +1,342 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Replay.h"
+#include "Hardware.h"
+#include "AnalogInputsADC.h"
+#include "Program.h"
+#include "Monitor.h"
+#include "SMPS.h"
+#include "Discharger.h"
+#include "Utils.h"
+#include "cpu.h"
+
+#define REPLAY_STEP_NS              10000000
+//stop if the firmware is still running after the end of the log
+#define REPLAY_OVERRUN_NS           600000000000ULL
+#define REPLAY_CURRENT_TOLERANCE    ANALOG_AMP(0.050)
+#define REPLAY_MAX_LINE             512
+
+namespace Replay {
+
+struct Frame {
+    uint32_t time;      //ms, from the start of the log
+    uint8_t channels;   //1 << n: a "$n" line
+    AnalogInputs::ValueType real[AnalogInputs::ALL_INPUTS];
+};
+
+namespace {
+    //keep in sync with SerialLog.cpp: channel1
+    const AnalogInputs::Name channel1[] = {
+            AnalogInputs::VoutBalancer,
+            AnalogInputs::Iout,
+            AnalogInputs::Cout,
+            AnalogInputs::Pout,
+            AnalogInputs::Eout,
+            AnalogInputs::Textern,
+            AnalogInputs::Tintern,
+            AnalogInputs::Vin,
+            AnalogInputs::Vb1,
+            AnalogInputs::Vb2,
+            AnalogInputs::Vb3,
+            AnalogInputs::Vb4,
+            AnalogInputs::Vb5,
+            AnalogInputs::Vb6,
+    };
+
+    const char * file_;
+    Frame * frames_;
+    uint32_t count_;
+    uint8_t program_;
+    uint32_t skipped_;
+
+    uint32_t origin_;           //the first frame with a current
+    uint32_t end_;              //the last frame with a current
+    uint32_t next_;
+    bool started_, finished_;
+    uint64_t fwOrigin_, fwLogEnd_;
+
+    //set current comparison
+    uint32_t compared_;
+    uint64_t sumDiff_;
+    AnalogInputs::ValueType maxDiff_;
+    uint32_t maxDiffTime_, divergeTime_;
+
+    bool parseLine(char * line, uint8_t &channel, uint8_t &program, uint32_t &time, char * &values)
+    {
+        if(line[0] != '$')
+            return false;
+        //checksum: xor of all characters up to the last ';'
+        char * end = strrchr(line, ';');
+        if(!end)
+            return false;
+        uint8_t crc = 0;
+        for(char * p = line; p <= end; p++)
+            crc ^= *p;
+        if(crc != atoi(end + 1))
+            return false;
+        *end = 0;
+
+        char * p = line + 1;
+        channel = strtol(p, &p, 10);
+        if(*p++ != ';') return false;
+        program = strtol(p, &p, 10);
+        if(*p++ != ';') return false;
+        time = strtol(p, &p, 10) * 1000;
+        if(*p == '.') {
+            p++;
+            time += strtol(p, &p, 10) * 100;
+        }
+        if(*p++ != ';') return false;
+        values = p;
+        return true;
+    }
+
+    void parseValues(Frame &f, uint8_t channel, char * values)
+    {
+        uint8_t i = 0;
+        for(char * v = strtok(values, ";"); v; v = strtok(NULL, ";"), i++) {
+            AnalogInputs::ValueType x = atol(v);
+            if(channel == 1 && i < sizeOfArray(channel1)) {
+                f.real[channel1[i]] = x;
+            } else if(channel == 2 && i < AnalogInputs::ALL_INPUTS) {
+                f.real[i] = x;
+            }
+        }
+        f.channels |= 1 << channel;
+    }
+
+    bool load()
+    {
+        FILE * f = fopen(file_, "r");
+        if(!f) {
+            perror(file_);
+            return false;
+        }
+        uint32_t size = 0;
+        char line[REPLAY_MAX_LINE];
+        while(fgets(line, sizeof(line), f)) {
+            line[strcspn(line, "\r\n")] = 0;
+            uint8_t channel, program;
+            uint32_t time;
+            char * values;
+            if(!parseLine(line, channel, program, time, values)) {
+                if(line[0] == '$') skipped_++;
+                continue;
+            }
+            if(channel != 1 && channel != 2)
+                continue;
+            if(count_ && time < frames_[count_ - 1].time)
+                break;
+            if(!count_ || time != frames_[count_ - 1].time) {
+                if(count_ == size) {
+                    size = size ? size * 2 : 1024;
+                    frames_ = (Frame *) realloc(frames_, size * sizeof(Frame));
+                }
+                memset(&frames_[count_], 0, sizeof(Frame));
+                frames_[count_].time = time;
+                count_++;
+                program_ = program;
+            }
+            parseValues(frames_[count_ - 1], channel, values);
+        }
+        fclose(f);
+        return count_ > 0;
+    }
+
+    bool hasChannel2(const Frame &f)
+    {
+        return f.channels & (1 << 2);
+    }
+
+    bool hasCurrent(const Frame &f)
+    {
+        if(f.real[AnalogInputs::Iout])
+            return true;
+        return hasChannel2(f) && (f.real[AnalogInputs::IsmpsSet] || f.real[AnalogInputs::IdischargeSet]);
+    }
+
+    void inject(const Frame &f)
+    {
+        using namespace AnalogInputs;
+        if(hasChannel2(f)) {
+            AnalogInputsADC::setReal(Vout_plus_pin, f.real[Vout_plus_pin]);
+            AnalogInputsADC::setReal(Vout_minus_pin, f.real[Vout_minus_pin]);
+            AnalogInputsADC::setReal(Ismps, f.real[Ismps]);
+            AnalogInputsADC::setReal(Idischarge, f.real[Idischarge]);
+        } else {
+            AnalogInputsADC::setReal(Vout_plus_pin, f.real[VoutBalancer]);
+            AnalogInputsADC::setReal(Vout_minus_pin, 0);
+            AnalogInputsADC::setReal(Ismps, SMPS::isPowerOn() ? f.real[Iout] : 0);
+            AnalogInputsADC::setReal(Idischarge, Discharger::isPowerOn() ? f.real[Iout] : 0);
+        }
+        //Vb0_pin, Vb1_pin, Vb2_pin: to ground, see ENABLE_SIMPLIFIED_VB0_VB2_CIRCUIT
+        AnalogInputsADC::setReal(Vb0_pin, 0);
+        AnalogInputsADC::setReal(Vb1_pin, f.real[Vb1]);
+        AnalogInputsADC::setReal(Vb2_pin, f.real[Vb1] + f.real[Vb2]);
+        for(uint8_t i = 2; i < MAX_BALANCE_CELLS; i++)
+            AnalogInputsADC::setReal(Name(Vb1_pin + i), f.real[Vb1 + i]);
+
+        AnalogInputsADC::setReal(Textern, f.real[Textern]);
+        AnalogInputsADC::setReal(Tintern, f.real[Tintern]);
+        AnalogInputsADC::setReal(Vin, f.real[Vin]);
+    }
+
+    int32_t getFirmwareSetCurrent()
+    {
+        int32_t i = 0;
+        if(SMPS::isPowerOn())
+            i += AnalogInputs::calibrateValue(AnalogInputs::IsmpsSet, SMPS::getValue());
+        if(Discharger::isPowerOn())
+            i -= AnalogInputs::calibrateValue(AnalogInputs::IdischargeSet, Discharger::getValue());
+        return i;
+    }
+
+    //the log time of the program start: the end of the last frame without a current
+    uint32_t getStartTime()
+    {
+        return frames_[origin_ ? origin_ - 1 : 0].time;
+    }
+
+    int32_t getLogSetCurrent(const Frame &f)
+    {
+        return int32_t(f.real[AnalogInputs::IsmpsSet]) - f.real[AnalogInputs::IdischargeSet];
+    }
+
+    //the measurements of the log and of the firmware are not in phase:
+    //the nearest of the frames k-1, k, k+1 is taken
+    void compare(uint32_t k)
+    {
+        const Frame &f = frames_[k];
+        if(!hasChannel2(f))
+            return;
+        int32_t fw = getFirmwareSetCurrent();
+        int32_t diff = INT32_MAX;
+        for(uint32_t i = k ? k - 1 : 0; i <= k + 1 && i < count_; i++) {
+            if(hasChannel2(frames_[i]) && abs(fw - getLogSetCurrent(frames_[i])) < diff)
+                diff = abs(fw - getLogSetCurrent(frames_[i]));
+        }
+        uint32_t time = f.time - getStartTime();
+        compared_++;
+        sumDiff_ += diff;
+        if(diff > maxDiff_) {
+            maxDiff_ = diff;
+            maxDiffTime_ = time;
+        }
+        if(diff > REPLAY_CURRENT_TOLERANCE && divergeTime_ == UINT32_MAX)
+            divergeTime_ = time;
+    }
+}
+
+bool initialize()
+{
+    file_ = cpu::getEnv("CHEALI_REPLAY", NULL);
+    if(!file_)
+        return false;
+    if(!load()) {
+        fprintf(stderr, "replay: %s: no frames\n", file_);
+        exit(1);
+    }
+    while(origin_ < count_ && !hasCurrent(frames_[origin_]))
+        origin_++;
+    if(origin_ == count_)
+        origin_ = 0;
+    end_ = count_ - 1;
+    while(end_ > origin_ && !hasCurrent(frames_[end_]))
+        end_--;
+    divergeTime_ = UINT32_MAX;
+
+    cpu::startTimer(cpu::TimerPlant, doInterrupt, REPLAY_STEP_NS, REPLAY_STEP_NS);
+    return true;
+}
+
+void doInterrupt()
+{
+    uint64_t now = cpu::getNanoseconds();
+    //Monitor: on from the start to the end of the program (before "complete")
+    bool running = Monitor::isPowerOn();
+
+    if(!started_) {
+        //hold the last frame before the program
+        inject(frames_[origin_ ? origin_ - 1 : 0]);
+        if(running) {
+            started_ = true;
+            fwOrigin_ = now;
+            next_ = origin_;
+            inject(frames_[next_]);
+            if(Program::programType + 1 != program_)
+                fprintf(stderr, "replay: warning: program %d, log program %d\n", Program::programType + 1, program_);
+        }
+        return;
+    }
+
+    if(!finished_) {
+        //a frame is the average since the previous one - it is written
+        //at the start of its interval, and compared at the end
+        uint32_t time = getStartTime() + (now - fwOrigin_) / 1000000;
+        while(next_ < count_ && frames_[next_].time <= time) {
+            compare(next_);
+            next_++;
+            if(next_ < count_)
+                inject(frames_[next_]);
+            else
+                fwLogEnd_ = now;
+        }
+    }
+
+    if(!running && !finished_) {
+        finished_ = true;
+        report();
+        exit(0);
+    }
+    if(next_ == count_ && now - fwLogEnd_ >= REPLAY_OVERRUN_NS) {
+        report();
+        exit(0);
+    }
+}
+
+void report()
+{
+    uint64_t now = cpu::getNanoseconds();
+    double logTime = (frames_[end_].time - getStartTime()) / 1000.0;
+    double fwTime = started_ ? (now - fwOrigin_) * 1e-9 : 0;
+    const char * reason = Program::stopReason ? Program::stopReason : "-";
+
+    fprintf(stderr, "replay: %s: %u frames, program %u, %u bad lines\n", file_, count_, program_, skipped_);
+    if(finished_) {
+        fprintf(stderr, "replay: end: log %.1fs, firmware %.1fs (%+.1fs), stop: %s\n",
+                logTime, fwTime, fwTime - logTime, reason);
+    } else {
+        fprintf(stderr, "replay: end: log %.1fs, firmware still running at %.1fs\n", logTime, fwTime);
+    }
+    if(compared_) {
+        fprintf(stderr, "replay: set current: %u frames, mean |diff| %umA, max %umA at %.1fs, ",
+                compared_, unsigned(sumDiff_ / compared_), maxDiff_, maxDiffTime_ / 1000.0);
+        if(divergeTime_ != UINT32_MAX)
+            fprintf(stderr, "first > %umA at %.1fs\n", REPLAY_CURRENT_TOLERANCE, divergeTime_ / 1000.0);
+        else
+            fprintf(stderr, "never > %umA\n", REPLAY_CURRENT_TOLERANCE);
+    } else {
+        fprintf(stderr, "replay: set current: not compared (no \"$2\" lines, UART: debug)\n");
+    }
+}
+
+} // namespace Replay
@@ -0,0 +1,52 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdint.h>
+
+/* host: SerialLog replay, CHEALI_REPLAY=file (instead of the Plant)
+ *
+ * the "$1;..." and "$2;..." lines of a recorded serial log (see SerialLog.cpp)
+ * are written to the ADC registers (AnalogInputsADC::setReal) in order,
+ * the firmware runs its normal program against them.
+ *  - the program start (Monitor::powerOn) is aligned with the end of
+ *    the last log frame without a current, that frame is held before.
+ *    A frame is the average since the previous one: it is written at the
+ *    start of its interval
+ *  - with "$2" lines (UART: debug) the set currents (IsmpsSet, IdischargeSet)
+ *    of the firmware are compared with the log
+ *  - at the end of the program (Monitor::powerOff) a report is written to
+ *    stderr and the process exits (also REPLAY_OVERRUN_NS after the end
+ *    of the log). The end of the log is its last frame with a current.
+ * only the first session of the log is used (the time must not go back).
+ *
+ * The program is started with the keys, as usual, e.g.:
+ *  echo "...l " | CHEALI_REPLAY=charge.log CHEALI_EEPROM=lipo3s.bin ./cheali-charger
+ */
+
+namespace Replay {
+    //false: CHEALI_REPLAY not set
+    bool initialize();
+
+    //TimerPlant handler
+    void doInterrupt();
+    void report();
+}
+
+#endif /* REPLAY_H_ */
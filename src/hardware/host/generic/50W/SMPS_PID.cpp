@@ -0,0 +1,332 @@
+#include "Hardware.h"
+#include "SMPS_PID.h"
+#include "IO.h"
+#include "AnalogInputs.h"
+#include "outputPWM.h"
+#include "atomic.h"
+#include "Monitor.h"
+
+#define ENABLE_DEBUG
+#include "debug.h"
+
+namespace {
+    volatile uint16_t i_PID_setpoint;
+    //we have to use i_PID_CutOffVoltage, on some chargers (M0516) ADC can read up to 60V
+    volatile uint16_t i_PID_CutOffVoltage;
+    //MV = FF + I + P (+ D), all << PID_MV_PRECISION
+    volatile long i_PID_MV;
+    volatile long i_PID_FF;
+    volatile long i_PID_I;
+    volatile uint16_t i_PID_PV;
+    volatile bool i_PID_enable;
+#ifdef ENABLE_SMPS_FEED_FORWARD
+    volatile uint8_t i_PID_hold;
+    //PID updates in a row within SMPS_FF_SETTLED_ERROR (up to SMPS_FF_SETTLED_COUNT)
+    volatile uint8_t i_PID_settled;
+    //the last settled operating point: current and the ideal Vout
+    AnalogInputs::ValueType ff_I;
+    uint32_t ff_V;
+    uint16_t ff_Rth;
+#endif
+#ifdef ENABLE_DISCHARGER_PID
+    //the discharger PWM: value * gain (>> DISCHARGER_PID_GAIN_PRECISION)
+    volatile uint16_t i_DPID_value;
+    volatile uint16_t i_DPID_target;
+    volatile uint32_t i_DPID_gain = DISCHARGER_PID_GAIN_ONE;
+    volatile uint8_t i_DPID_hold;
+
+    uint16_t getDischargerPWM()
+    {
+        uint32_t v = (i_DPID_value * i_DPID_gain) >> DISCHARGER_PID_GAIN_PRECISION;
+        if(v > DISCHARGER_UPPERBOUND_VALUE)
+            v = DISCHARGER_UPPERBOUND_VALUE;
+        return v;
+    }
+#endif
+}
+
+uint16_t hardware::getPIDValue()
+{
+    uint16_t v;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        v = i_PID_MV>>PID_MV_PRECISION;
+    }
+    return v;
+}
+
+
+void SMPS_PID::update()
+{
+    if(!i_PID_enable) return;
+    //if Vout is too high disable PID
+    if(AnalogInputs::getADCValue(AnalogInputs::Vout_plus_pin) >= i_PID_CutOffVoltage) {
+    	hardware::setChargerOutput(false);
+        i_PID_enable = false;
+        //LogDebug(AnalogInputs::getADCValue(AnalogInputs::Vout_plus_pin), ">=", i_PID_CutOffVoltage);
+        Monitor::i_externalError = MONITOR_EXTERNAL_ERROR_BATTERY_DISCONNECTED;
+        return;
+    }
+
+    uint16_t PV = AnalogInputs::getADCValue(AnalogInputs::Ismps);
+    long error = i_PID_setpoint;
+    error -= PV;
+
+    long kp = PID_KP_BUCK, ki = PID_KI_BUCK, kd = PID_KD_BUCK;
+    if(i_PID_MV > ((long) OUTPUT_PWM_PRECISION_PERIOD << PID_MV_PRECISION)) {
+        kp = PID_KP_BOOST; ki = PID_KI_BOOST; kd = PID_KD_BOOST;
+    }
+#ifdef ENABLE_SMPS_FEED_FORWARD
+    //a new setpoint was preloaded: wait for the converter,
+    //the Ismps measurement lags behind the current
+    if(i_PID_hold) {
+        i_PID_hold--;
+        i_PID_settled = 0;
+        kp = 0; ki = 0;
+    } else if((error < 0 ? -error : error) <= (long) (i_PID_setpoint >> SMPS_FF_SETTLED_SHIFT) + SMPS_FF_SETTLED_ERROR) {
+        if(i_PID_settled < SMPS_FF_SETTLED_COUNT) i_PID_settled++;
+    } else {
+        i_PID_settled = 0;
+    }
+#endif
+    long I = i_PID_I + error*ki;
+    long MV = i_PID_FF + I + error*kp;
+    MV -= ((long) PV - i_PID_PV)*kd;
+    i_PID_PV = PV;
+
+    //anti-windup (conditional integration): the integral
+    //doesn't go further into the saturation
+    if(MV < 0) {
+        MV = 0;
+        if(error < 0) I = i_PID_I;
+    } else if((uint32_t)MV > MAX_PID_MV_PRECISION) {
+        MV = MAX_PID_MV_PRECISION;
+        if(error > 0) I = i_PID_I;
+    }
+    i_PID_I = I;
+    i_PID_MV = MV;
+
+    SMPS_PID::setPID_MV(MV>>PID_MV_PRECISION);
+}
+
+uint16_t SMPS_PID::getFeedForward(uint16_t Vin, uint16_t Vout)
+{
+    if(Vin == 0)
+        return 0;
+    //buck: D = Vout/Vin
+    if(Vout <= Vin)
+        return (uint32_t) Vout * OUTPUT_PWM_PRECISION_PERIOD / Vin;
+    //boost: D = 1 - Vin/Vout
+    uint32_t v = OUTPUT_PWM_PRECISION_PERIOD + (uint32_t) (Vout - Vin) * OUTPUT_PWM_PRECISION_PERIOD / Vout;
+    if(v > MAX_PID_MV)
+        v = MAX_PID_MV;
+    return v;
+}
+
+uint32_t SMPS_PID::getIdealVout(uint16_t Vin, uint16_t MV)
+{
+    //buck: Vout = Vin*D
+    if(MV <= OUTPUT_PWM_PRECISION_PERIOD)
+        return (uint32_t) Vin * MV / OUTPUT_PWM_PRECISION_PERIOD;
+    //boost: Vout = Vin/(1-D), MV <= MAX_PID_MV < 2*OUTPUT_PWM_PRECISION_PERIOD
+    return (uint32_t) Vin * OUTPUT_PWM_PRECISION_PERIOD / (2*OUTPUT_PWM_PRECISION_PERIOD - MV);
+}
+
+void SMPS_PID::init(uint16_t Vin, uint16_t Vout)
+{
+    long ff = (long) getFeedForward(Vin, Vout) << PID_MV_PRECISION;
+#ifdef ENABLE_SMPS_FEED_FORWARD
+    //no current: the converter output is the battery EMF
+    ff_I = 0;
+    ff_V = Vout;
+    ff_Rth = SMPS_FF_RTH_DEFAULT;
+    i_PID_hold = 0;
+    i_PID_settled = 0;
+#endif
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        i_PID_setpoint = 0;
+        i_PID_FF = ff;
+        i_PID_I = 0;
+        i_PID_MV = ff;
+        i_PID_PV = AnalogInputs::getADCValue(AnalogInputs::Ismps);
+        i_PID_enable = true;
+    }
+
+}
+
+namespace {
+    void enableChargerBuck() {
+        outputPWM::disablePWM(SMPS_VALUE_BUCK_PIN);
+        IO::digitalWrite(SMPS_VALUE_BUCK_PIN, 1);
+    }
+    void disableChargerBuck() {
+        outputPWM::disablePWM(SMPS_VALUE_BUCK_PIN);
+        IO::digitalWrite(SMPS_VALUE_BUCK_PIN, 0);
+    }
+    void disableChargerBoost() {
+        outputPWM::disablePWM(SMPS_VALUE_BOOST_PIN);
+        IO::digitalWrite(SMPS_VALUE_BOOST_PIN, 0);
+    }
+}
+
+void SMPS_PID::setPID_MV(uint16_t value) {
+    if(value > MAX_PID_MV)
+        value = MAX_PID_MV;
+
+    if(value <= OUTPUT_PWM_PRECISION_PERIOD) {
+        disableChargerBoost();
+        outputPWM::setPWM(SMPS_VALUE_BUCK_PIN, value);
+    } else {
+        enableChargerBuck();
+        uint16_t v2 = value - OUTPUT_PWM_PRECISION_PERIOD;
+        outputPWM::setPWM(SMPS_VALUE_BOOST_PIN, v2);
+    }
+}
+
+void hardware::setVoutCutoff(AnalogInputs::ValueType v) {
+	//LogDebug("Max charge: ",MAX_CHARGE_V, " v:", v);
+
+    if(v > MAX_CHARGE_V) {
+        v = MAX_CHARGE_V;
+    }
+    AnalogInputs::ValueType cutOff = AnalogInputs::reverseCalibrateValue(AnalogInputs::Vout_plus_pin, v);
+    if(cutOff > ANALOG_INPUTS_MAX_ADC_Vout_plus_pin) {
+        //extra limit if calibration is wrong
+        cutOff = ANALOG_INPUTS_MAX_ADC_Vout_plus_pin;
+    }
+    //LogDebug("cutof: ",cutOff);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        i_PID_CutOffVoltage = cutOff;
+    }
+}
+
+#ifdef ENABLE_SMPS_FEED_FORWARD
+namespace {
+    //the MV change for a new setpoint: Vout = Videal(MV) + (Inew - I)*Rth
+    long getFeedForwardStep(uint16_t setpoint, uint16_t value)
+    {
+        long MV;
+        bool settled;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            MV = i_PID_MV >> PID_MV_PRECISION;
+            settled = i_PID_hold == 0 && i_PID_settled >= SMPS_FF_SETTLED_COUNT;
+        }
+        uint16_t Vin = AnalogInputs::getRealValue(AnalogInputs::Vin);
+        AnalogInputs::ValueType I = AnalogInputs::calibrateValue(AnalogInputs::IsmpsSet, setpoint);
+        AnalogInputs::ValueType Inew = AnalogInputs::calibrateValue(AnalogInputs::IsmpsSet, value);
+        uint32_t V = SMPS_PID::getIdealVout(Vin, MV);
+
+        //learn Rth from the last settled operating point, a transient
+        //(or saturated) MV is not the converter model
+        if(settled) {
+            long dI = (long) I - ff_I;
+            if(dI >= SMPS_FF_RTH_MIN_DELTA_I || -dI >= SMPS_FF_RTH_MIN_DELTA_I) {
+                long Rth = ((long) V - (long) ff_V) * 1000 / dI;
+                if(Rth < SMPS_FF_RTH_MIN) Rth = SMPS_FF_RTH_MIN;
+                if(Rth > SMPS_FF_RTH_MAX) Rth = SMPS_FF_RTH_MAX;
+                ff_Rth = (ff_Rth + Rth) / 2;
+            }
+            ff_I = I;
+            ff_V = V;
+        }
+
+        long Vnew = (long) V + ((long) Inew - I) * ff_Rth / 1000;
+        if(Vnew < 0) Vnew = 0;
+        if(Vnew > 0xffff) Vnew = 0xffff;
+        return ((long) SMPS_PID::getFeedForward(Vin, Vnew) - MV) << PID_MV_PRECISION;
+    }
+}
+#endif
+
+void hardware::setChargerValue(uint16_t value)
+{
+#ifdef ENABLE_SMPS_FEED_FORWARD
+    //preload the integral, the PID only trims the model error
+    if(i_PID_enable && value != i_PID_setpoint) {
+        long step = getFeedForwardStep(i_PID_setpoint, value);
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            i_PID_I += step;
+            i_PID_setpoint = value;
+            i_PID_hold = SMPS_FF_HOLD;
+        }
+        return;
+    }
+#endif
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        i_PID_setpoint = value;
+    }
+
+//  TODO: test without PID
+//  SMPS_PID::setPID_MV(value);
+//  outputPWM::setPWM(SMPS_VALUE_BUCK_PIN, value);
+}
+
+void hardware::setChargerOutput(bool enable)
+{
+    if(enable) setDischargerOutput(false);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        i_PID_enable = false;
+        disableChargerBuck();
+        disableChargerBoost();
+    }
+    IO::digitalWrite(SMPS_DISABLE_PIN, !enable);
+    if(enable) {
+        SMPS_PID::init(AnalogInputs::getRealValue(AnalogInputs::Vin), AnalogInputs::getRealValue(AnalogInputs::Vout_plus_pin));
+    }
+}
+
+
+void hardware::setDischargerOutput(bool enable)
+{
+    if(enable) setChargerOutput(false);
+#ifdef ENABLE_DISCHARGER_PID
+    //a new discharge starts from the calibration (open loop)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        i_DPID_target = 0;
+        i_DPID_gain = DISCHARGER_PID_GAIN_ONE;
+    }
+#endif
+    IO::digitalWrite(DISCHARGE_DISABLE_PIN, !enable);
+}
+
+void hardware::setDischargerValue(uint16_t value)
+{
+#ifdef ENABLE_DISCHARGER_PID
+    //the learned gain stays: a new current is right at once
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(value != i_DPID_value)
+            i_DPID_hold = DISCHARGER_PID_HOLD;
+        i_DPID_value = value;
+        outputPWM::setPWM(DISCHARGE_VALUE_PIN, getDischargerPWM());
+    }
+#else
+    outputPWM::setPWM(DISCHARGE_VALUE_PIN, value);
+#endif
+}
+
+#ifdef ENABLE_DISCHARGER_PID
+void hardware::setDischargerTarget(uint16_t Idischarge)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        i_DPID_target = Idischarge;
+    }
+}
+
+void SMPS_PID::updateDischarger(uint16_t adc)
+{
+    if(!i_DPID_target)
+        return;
+    //the measurement straddles a new value
+    if(i_DPID_hold) {
+        i_DPID_hold--;
+        return;
+    }
+    long error = (long) i_DPID_target - adc;
+    //I only, on the relative error: the same loop gain at every current
+    long gain = i_DPID_gain + (error << (DISCHARGER_PID_GAIN_PRECISION - DISCHARGER_PID_KI_SHIFT)) / i_DPID_target;
+    if(gain < DISCHARGER_PID_GAIN_MIN) gain = DISCHARGER_PID_GAIN_MIN;
+    if(gain > DISCHARGER_PID_GAIN_MAX) gain = DISCHARGER_PID_GAIN_MAX;
+    i_DPID_gain = gain;
+    outputPWM::setPWM(DISCHARGE_VALUE_PIN, getDischargerPWM());
+}
+#endif
+
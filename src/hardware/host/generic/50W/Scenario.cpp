@@ -0,0 +1,338 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Scenario.h"
+#include "Plant.h"
+#include "Program.h"
+#include "ProgramData.h"
+#include "Monitor.h"
+#include "SMPS.h"
+#include "Strategy.h"
+#include "Discharger.h"
+#include "Settings.h"
+#include "AnalogInputs.h"
+#include "Terminal.h"
+#include "eeprom.h"
+#include "memory.h"
+#include "Version.h"
+#include "Utils.h"
+#include "cpu.h"
+
+//the start info is not confirmed (wrong cell count, ...)
+#define SCENARIO_START_TIMEOUT_NS   10000000000ULL
+//the key is released in between (waitButtonPressed())
+#define SCENARIO_KEY_PERIOD_NS      4000000000ULL
+#define SCENARIO_MAX_STEPS          16
+//step response: sampling period, settling band (of the step, at least SCENARIO_BAND_MIN_MA)
+#define SCENARIO_SAMPLE_NS          100000
+#define SCENARIO_BAND               0.02
+#define SCENARIO_BAND_MIN_MA        10
+#define SCENARIO_IC_REACHED         0.95
+
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+//AnalogInputs.cpp: mA * timer ticks, mA * mV * timer ticks
+namespace AnalogInputs { extern volatile uint64_t i_charge_, i_Eout_; }
+#endif
+
+namespace Scenario {
+
+namespace {
+    //Program::ProgramType order
+    const char * const programNames[] = {
+            "charge", "chargeBalance", "balance", "discharge", "fastCharge",
+            "storage", "storageBalance", "dcCycle", "capacityCheck"};
+
+    bool enabled_, started_, running_;
+    Program::ProgramType program_ = Program::ChargeBalance;
+    uint16_t ic_, id_, cycles_ = 1, rest_ = 1;
+    uint8_t uart_;
+    uint64_t start_, lastKey_;
+    //the first time the charge current reached SCENARIO_IC_REACHED of
+    //Strategy::maxI (limited by the charger power)
+    double icTime_ = -1;
+    //discharge current error: Discharger::getIout() - the Plant, time weighted
+    double idError_, idTime_;
+    uint64_t idSample_;
+    uint16_t steps_[SCENARIO_MAX_STEPS];
+    uint8_t stepCount_;
+    uint16_t hold_ = 300, ramp_;
+
+    void parseSteps(char * v)
+    {
+        for(char * s = strtok_r(v, ":", &v); s && stepCount_ < SCENARIO_MAX_STEPS; s = strtok_r(NULL, ":", &v))
+            steps_[stepCount_++] = atoi(s);
+    }
+
+    void parseConfig(const char * config)
+    {
+        char buf[256];
+        strncpy(buf, config, sizeof(buf) - 1);
+        buf[sizeof(buf) - 1] = 0;
+        for(char * p = strtok(buf, ","); p; p = strtok(NULL, ",")) {
+            char * v = strchr(p, '=');
+            if(!v) continue;
+            *v++ = 0;
+            if(!strcmp(p, "program")) {
+                uint8_t i = 0;
+                while(i < sizeOfArray(programNames) && strcmp(v, programNames[i]))
+                    i++;
+                if(i == sizeOfArray(programNames)) {
+                    fprintf(stderr, "scenario: unknown program: %s\n", v);
+                    exit(1);
+                }
+                program_ = Program::ProgramType(i);
+                continue;
+            }
+            if(!strcmp(p, "steps")) {
+                parseSteps(v);
+                continue;
+            }
+            int x = atoi(v);
+            if(!strcmp(p, "ic"))                ic_ = x;
+            else if(!strcmp(p, "id"))           id_ = x;
+            else if(!strcmp(p, "cycles"))       cycles_ = x;
+            else if(!strcmp(p, "rest"))         rest_ = x;
+            else if(!strcmp(p, "hold"))         hold_ = x;
+            else if(!strcmp(p, "ramp"))         ramp_ = x;
+            else if(!strcmp(p, "uart"))         uart_ = x;
+            else fprintf(stderr, "scenario: unknown option: %s\n", p);
+        }
+    }
+
+    void setupBattery()
+    {
+        using namespace ProgramData;
+        //the "None" defaults first: time limit, capacity cutoff, ...
+        battery.type = NoneBatteryType;
+        changedType();
+        battery.type = Plant::getBatteryType();
+        battery.cells = Plant::getCells();
+        battery.capacity = Plant::getCapacity();
+        changedType();
+        if(ic_) {
+            battery.Ic = ic_;
+            changedIc();
+        }
+        if(id_) {
+            battery.Id = id_;
+            changedId();
+        }
+        battery.DCRestTime = rest_;
+        if(isNiXX())
+            battery.DCcycles = cycles_;
+    }
+
+    void report(double time)
+    {
+        Plant::report();
+        Plant::Result r;
+        Plant::getResult(r);
+        fprintf(stderr, "scenario: %s: time %.1fs, charged %.0fmAh %.2fWh, discharged %.0fmAh %.2fWh,"
+                " spread %.1fmV %.2f%%, T max %.1fC, Ic after %.1fs, Id error %.1fmA, stop: %s\n",
+                programNames[program_], time, r.charged, r.energyIn, r.discharged, r.energyOut,
+                r.ocvSpread, r.socSpread, r.maxTemperature, icTime_,
+                idTime_ > 0 ? sqrt(idError_ / idTime_) : -1.0,
+                Program::stopReason ? Program::stopReason : "-");
+    }
+
+    //the settings are restored last
+    bool isEepromValid()
+    {
+        return eeprom::read(&eeprom::data.settingVersion) == CHEALI_CHARGER_EEPROM_SETTINGS_VERSION
+                && !eeprom::restoreCalibrationCRC(false) && !eeprom::restoreProgramDataCRC(false)
+                && !eeprom::restoreSettingsCRC(false);
+    }
+
+    void pressStart(bool longPress = false)
+    {
+        uint64_t now = cpu::getNanoseconds();
+        if(now - lastKey_ >= SCENARIO_KEY_PERIOD_NS && Terminal::pressKey(' ', longPress))
+            lastKey_ = now;
+    }
+
+    void fail(const char * what)
+    {
+        fprintf(stderr, "scenario: %s: %s\n", programNames[program_], what);
+        exit(1);
+    }
+
+    void sampleIdError(uint64_t now)
+    {
+        double dt = (now - idSample_) * 1e-9;
+        idSample_ = now;
+        if(!running_ || !Discharger::isWorking())
+            return;
+        double error = -Plant::getCurrent() * 1000 - Discharger::getIout();
+        idError_ += error * error * dt;
+        idTime_ += dt;
+    }
+
+    struct StepResult {
+        double rise, overshoot, settling;   //ms, % of the step, ms
+        double error, ripple;               //mA: mean and peak-to-peak at the end of the hold
+    };
+
+    void setSmpsValue(double I)
+    {
+        SMPS::setValue(AnalogInputs::reverseCalibrateValue(AnalogInputs::IsmpsSet, I));
+    }
+
+    //one setpoint change (a ramp_ long ramp), the current of the Plant
+    //sampled every SCENARIO_SAMPLE_NS
+    void runStep(double from, double to, StepResult &r)
+    {
+        const double ramp = ramp_ * 1e6;
+        const double hold = ramp + hold_ * 1e6;
+        const double step = to - from;
+        const double band = fmax(fabs(step) * SCENARIO_BAND, SCENARIO_BAND_MIN_MA);
+        double rise10 = -1, rise90 = -1, peak = 0, lastOutside = 0;
+        double tailSum = 0, tailMin = 1e9, tailMax = -1e9;
+        uint32_t tailCount = 0;
+
+        setSmpsValue(ramp ? from : to);
+        for(double t = SCENARIO_SAMPLE_NS; t <= hold; t += SCENARIO_SAMPLE_NS) {
+            cpu::delay(SCENARIO_SAMPLE_NS);
+            if(t <= ramp)
+                setSmpsValue(from + step * t / ramp);
+            double i = Plant::getCurrent() * 1000;
+            double progress = step ? (i - from) / step : 1;
+            if(rise10 < 0 && progress >= 0.1) rise10 = t;
+            if(rise90 < 0 && progress >= 0.9) rise90 = t;
+            if(progress - 1 > peak) peak = progress - 1;
+            if(fabs(i - to) > band) lastOutside = t;
+            if(t > hold - hold_ * 0.2e6) {
+                tailSum += i;
+                tailCount++;
+                tailMin = fmin(tailMin, i);
+                tailMax = fmax(tailMax, i);
+            }
+        }
+        r.rise = (rise10 < 0 || rise90 < 0) ? hold_ : (rise90 - rise10) * 1e-6;
+        r.overshoot = peak * 100;
+        r.settling = lastOutside * 1e-6;
+        r.error = tailSum / tailCount - to;
+        r.ripple = tailMax - tailMin;
+    }
+
+    //the charge and energy of AnalogInputs (getCharge(), getEout()) against the Plant
+    void reportIntegration()
+    {
+        Plant::Result r;
+        Plant::getResult(r);
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+        double charge = AnalogInputs::i_charge_ * (TIMER_INTERRUPT_PERIOD_MICROSECONDS / 3.6e9);
+        double energy = AnalogInputs::i_Eout_ * (TIMER_INTERRUPT_PERIOD_MICROSECONDS / 3.6e15);
+#else
+        double charge = AnalogInputs::getCharge();
+        double energy = AnalogInputs::getEout() * 0.01;
+#endif
+        fprintf(stderr, "scenario: integration: charge %.2fmAh (Plant %.2fmAh, %+.2f%%),"
+                " energy %.4fWh (Plant %.4fWh, %+.2f%%)\n",
+                charge, r.charged, (charge / r.charged - 1) * 100,
+                energy, r.energyIn, (energy / r.energyIn - 1) * 100);
+    }
+
+    //SMPS current controller (SMPS_PID), without the SMPS::trySetIout() ramp
+    void runSteps()
+    {
+        StepResult worst = {0, 0, 0, 0, 0};
+        //the calibration of a new eeprom: after hardware::initialize()
+        hardware::setVoutCutoff(MAX_CHARGE_V);
+        AnalogInputs::powerOn();
+        SMPS::powerOn();
+        double from = 0;
+        for(uint8_t k = 0; k < stepCount_; k++) {
+            StepResult r;
+            runStep(from, steps_[k], r);
+            fprintf(stderr, "step: %.0f -> %umA: rise %.1fms, overshoot %.1f%%, settling %.1fms,"
+                    " error %.1fmA, ripple %.1fmA\n",
+                    from, steps_[k], r.rise, r.overshoot, r.settling, r.error, r.ripple);
+            worst.rise = fmax(worst.rise, r.rise);
+            worst.overshoot = fmax(worst.overshoot, r.overshoot);
+            worst.settling = fmax(worst.settling, r.settling);
+            worst.error = fmax(worst.error, fabs(r.error));
+            worst.ripple = fmax(worst.ripple, r.ripple);
+            from = steps_[k];
+        }
+        reportIntegration();
+        SMPS::powerOff();
+        AnalogInputs::powerOff();
+        fprintf(stderr, "scenario: step: rise %.1fms, overshoot %.1f%%, settling %.1fms, error %.1fmA, ripple %.1fmA\n",
+                worst.rise, worst.overshoot, worst.settling, worst.error, worst.ripple);
+        exit(0);
+    }
+}
+
+bool initialize()
+{
+    const char * config = cpu::getEnv("CHEALI_SCENARIO", NULL);
+    if(!config)
+        return false;
+    parseConfig(config);
+    enabled_ = true;
+    return true;
+}
+
+void keyboardRead()
+{
+    if(!enabled_)
+        return;
+    uint64_t now = cpu::getNanoseconds();
+
+    if(!started_) {
+        //a new eeprom: confirm the reset (eeprom::check())
+        if(!isEepromValid()) {
+            pressStart();
+            return;
+        }
+        started_ = true;
+        start_ = now;
+        if(stepCount_)
+            runSteps();
+        setupBattery();
+        settings.UART = Settings::UARTType(uart_);
+        Program::run(program_);
+        fail("the program was not started");
+    }
+
+    if(Program::programState == Program::Info) {
+        if(now - start_ > SCENARIO_START_TIMEOUT_NS)
+            fail("the start info was not confirmed");
+        pressStart(true);
+        return;
+    }
+
+    sampleIdError(now);
+    //Monitor: on from the start to the end of the program (before "complete")
+    bool on = Monitor::isPowerOn();
+    if(on && !running_) {
+        running_ = true;
+        start_ = now;
+    } else if(on && icTime_ < 0 && Plant::getCurrent() * 1000 >= min(Strategy::maxI, SMPS::getMaxIout()) * SCENARIO_IC_REACHED) {
+        icTime_ = (now - start_) * 1e-9;
+    } else if(!on && running_) {
+        report((now - start_) * 1e-9);
+        exit(0);
+    }
+}
+
+} // namespace Scenario
@@ -0,0 +1,68 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SCENARIO_H_
+#define SCENARIO_H_
+
+#include <stdint.h>
+
+/* host: end-to-end program benchmark, CHEALI_SCENARIO="key=value,..."
+ * (on top of the Plant)
+ *
+ * the battery is set up from the Plant (chemistry, cells, capacity), the
+ * program is started (Program::run) instead of the main menu and the start
+ * info is confirmed. At the end of the program (Monitor::powerOff) the Plant
+ * report and one "scenario:" line are written to stderr and the process
+ * exits: completion time (Monitor on), charge and energy, final cell spread
+ * (OCV and SoC), peak battery temperature, the time to reach the charge
+ * current (95% of Strategy::maxI, limited by the charger power; -1: never),
+ * the rms error of the discharge current (the set one - the Plant, while
+ * the discharger works; -1: no discharge) and the stop reason.
+ *
+ * options (default value):
+ *  program (chargeBalance) - charge, chargeBalance, balance, discharge,
+ *      fastCharge, storage, storageBalance, dcCycle, capacityCheck
+ *  ic, id [mA] (ProgramData defaults: 1C, Pb: C/4, limited by the charger)
+ *  cycles (1), rest [minutes] (1) - dcCycle, capacityCheck
+ *  uart (0) - the SerialLog (Settings::UARTType, 1: normal, 2: debug),
+ *      written to CHEALI_SERIAL, e.g. for CHEALI_REPLAY or CHEALI_BENCH=stable
+ *  steps [mA] (none) - e.g. steps=500:2000:100, a step response of the SMPS
+ *      current controller (SMPS_PID) instead of a program: the setpoint goes
+ *      straight to each value (no SMPS::trySetIout() ramp), for hold [ms] (300).
+ *      Per step and the worst case ("scenario: step:"): the 10-90% rise
+ *      time, overshoot, settling time (2% band of the step, at least 10mA),
+ *      the error and ripple of the current in the last 20% of the hold.
+ *      At the end ("scenario: integration:"): the charge and energy
+ *      integrated by AnalogInputs against the Plant
+ *  ramp [ms] (0) - steps: the setpoint goes to each value linearly, in ramp,
+ *      then stays for hold (hold: up to 65535)
+ *
+ * exit status: 0 - the program ended, 1 - it could not be started.
+ * A new (or invalid) eeprom is reset to the defaults, the battery is not
+ * saved. A suite: scenarios.sh, e.g.:
+ *  CHEALI_PLANT=chem=nimh,cells=8,soc=10 CHEALI_SCENARIO=program=charge ./cheali-charger
+ */
+
+namespace Scenario {
+    //false: CHEALI_SCENARIO not set
+    bool initialize();
+
+    //hardware::getKeyPressed(): the main loop
+    void keyboardRead();
+}
+
+#endif /* SCENARIO_H_ */
@@ -0,0 +1,162 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2013  Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "imaxB6.h"
+#include "SMPS_PID.h"
+#include "AnalogInputsADC.h"
+#include "SerialLog.h"
+#include "IO.h"
+#include "Keyboard.h"
+#include "outputPWM.h"
+#include "LiquidCrystal.h"
+#include "Plant.h"
+#include "Replay.h"
+#include "Fuzz.h"
+#include "Scenario.h"
+#include "Benchmark.h"
+#include "cpu.h"
+
+#ifndef PINS_H_
+#error pins not defined (include *pins.h header in your HardwareConfig.h)
+#endif
+
+uint8_t hardware::getKeyPressed()
+{
+    Fuzz::keyboardRead();
+    Scenario::keyboardRead();
+    return   (IO::digitalRead(BUTTON_STOP_PIN) ? 0 : BUTTON_STOP)
+            | (IO::digitalRead(BUTTON_DEC_PIN)  ? 0 : BUTTON_DEC)
+            | (IO::digitalRead(BUTTON_INC_PIN)  ? 0 : BUTTON_INC)
+            | (IO::digitalRead(BUTTON_START_PIN)? 0 : BUTTON_START);
+}
+
+
+void hardware::setBalancerOutput(bool enable)
+{
+}
+
+void hardware::initializePins()
+{
+    setBalancer(0);
+    setBatteryOutput(false);
+    //setFan(false);
+    setBuzzer(0);
+
+    IO::pinMode(BALANCER1_LOAD_PIN, OUTPUT);
+    IO::pinMode(BALANCER2_LOAD_PIN, OUTPUT);
+    IO::pinMode(BALANCER3_LOAD_PIN, OUTPUT);
+    IO::pinMode(BALANCER4_LOAD_PIN, OUTPUT);
+    IO::pinMode(BALANCER5_LOAD_PIN, OUTPUT);
+    IO::pinMode(BALANCER6_LOAD_PIN, OUTPUT);
+
+    IO::pinMode(BUTTON_STOP_PIN, INPUT);
+    IO::pinMode(BUTTON_DEC_PIN, INPUT);
+    IO::pinMode(BUTTON_INC_PIN, INPUT);
+    IO::pinMode(BUTTON_START_PIN, INPUT);
+    IO::pinMode(OUTPUT_DISABLE_PIN, OUTPUT);
+    //IO::pinMode(FAN_PIN, OUTPUT);
+    IO::pinMode(BUZZER_PIN, OUTPUT);
+    IO::pinMode(BACKLIGHT_PIN, OUTPUT);
+
+    IO::pinMode(DISCHARGE_VALUE_PIN, OUTPUT);
+    IO::pinMode(DISCHARGE_DISABLE_PIN, OUTPUT);
+
+
+    IO::pinMode(SMPS_VALUE_BUCK_PIN, OUTPUT);
+    IO::pinMode(SMPS_VALUE_BOOST_PIN, OUTPUT);
+    IO::pinMode(SMPS_DISABLE_PIN, OUTPUT);
+
+    //IO::digitalWrite(SMPS_DISABLE_PIN, 1);
+    //while(1);
+}
+
+
+void hardware::initialize()
+{
+    LiquidCrystal::init();
+    LiquidCrystal::begin(LCD_COLUMNS, LCD_LINES);
+    AnalogInputsADC::initialize();
+    outputPWM::initialize();
+    if(!Replay::initialize()) {
+        Plant::initialize();
+        Fuzz::initialize();
+        Scenario::initialize();
+    }
+    setVoutCutoff(MAX_CHARGE_V);
+    Benchmark::run();
+}
+
+
+void hardware::soundInterrupt()
+{}
+
+void hardware::waitForInterrupt()
+{
+    cpu::waitForInterrupt();
+}
+
+void hardware::setBuzzer(uint8_t val)
+{
+	IO::digitalWrite(BUZZER_PIN, (val&1));
+	//outputPWM::setPWM(BUZZER_PIN, 120);
+
+}
+
+void hardware::setLCDBacklight(uint8_t val)
+{
+    uint32_t v1,v2;
+    v1  = LCD_BACKLIGHT_MAX;
+    v1 *= val;
+    v2  = LCD_BACKLIGHT_MIN;
+    v2 *= 100 - val;
+    v1+=v2;
+    v1/=100;
+    outputPWM::setPWM(BACKLIGHT_PIN, v1);
+    //IO::digitalWrite(BACKLIGHT_PIN, 1);
+}
+/*
+void hardware::setFan(bool enable)
+{
+    IO::digitalWrite(FAN_PIN, enable);
+}
+*/
+void hardware::setBatteryOutput(bool enable)
+{
+    IO::digitalWrite(OUTPUT_DISABLE_PIN, !enable);
+    if(!enable) {
+        setChargerOutput(false);
+        setDischargerOutput(false);
+    }
+}
+
+void hardware::setBalancer(uint8_t v)
+{
+    IO::digitalWrite(BALANCER1_LOAD_PIN, v&1);
+    IO::digitalWrite(BALANCER2_LOAD_PIN, v&2);
+    IO::digitalWrite(BALANCER3_LOAD_PIN, v&4);
+    IO::digitalWrite(BALANCER4_LOAD_PIN, v&8);
+    IO::digitalWrite(BALANCER5_LOAD_PIN, v&16);
+    IO::digitalWrite(BALANCER6_LOAD_PIN, v&32);
+}
+
+void hardware::setExternalTemperatueOutput(bool enable)
+{
+    if(enable) {
+        IO::pinMode(T_EXTERNAL_PIN, ANALOG_INPUT);
+    }
+}
+
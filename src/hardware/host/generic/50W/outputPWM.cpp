@@ -0,0 +1,61 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "outputPWM.h"
+#include "IO.h"
+#include "Hardware.h"
+
+//host: the PWM outputs are registers, see getPWM()
+
+namespace outputPWM {
+
+namespace {
+    uint32_t value_[256];
+    bool enabled_[256];
+}
+
+void initialize(void)
+{
+}
+
+void setPWM(uint8_t pin, uint32_t value)
+{
+    if(value > OUTPUT_PWM_PRECISION_PERIOD)
+        value = OUTPUT_PWM_PRECISION_PERIOD;
+    value_[pin] = value;
+    enabled_[pin] = true;
+}
+
+void disablePWM(uint8_t pin)
+{
+    enabled_[pin] = false;
+}
+
+uint32_t getPWM(uint8_t pin)
+{
+    if(enabled_[pin])
+        return value_[pin];
+    return IO::digitalRead(pin) ? OUTPUT_PWM_PRECISION_PERIOD : 0;
+}
+
+uint16_t getSmpsCMR()
+{
+    uint8_t pin = enabled_[SMPS_VALUE_BOOST_PIN] ? SMPS_VALUE_BOOST_PIN : SMPS_VALUE_BUCK_PIN;
+    return getPWM(pin) / OUTPUT_PWM_PRECISION_FACTOR;
+}
+
+} //namespace outputPWM
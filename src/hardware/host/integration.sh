@@ -0,0 +1,65 @@
+#!/bin/bash
+#
+# charge and energy integration (AnalogInputs::getCharge(), getEout())
+# against the Plant on the host
+#
+# usage: integration.sh CHEALI_CHARGER [FILTER]
+#  e.g.: integration.sh build/cheali-charger boost
+#
+# every case runs a current profile: CHEALI_SCENARIO=steps=...,ramp=...
+# (see generic/50W/Scenario.h) against the Plant (CHEALI_PLANT, see
+# generic/50W/Plant.h) with the SMPS inductor current ripple (l), in the
+# buck and the boost region of the converter. The table: the charge and
+# energy of the charger and of the Plant, the error.
+# FILTER: only the cases with a matching name (grep -E).
+#
+# environment:
+#  MAX_ERROR    the allowed error [%] (default: 2)
+#  PLANT        more plant options, e.g. noise=12
+#
+# exit status: 1 if a case did not end or an error is above MAX_ERROR
+
+# name              plant (CHEALI_PLANT)                        profile (CHEALI_SCENARIO)
+CASES="
+buck-3s-steps       chem=lipo,cells=3,soc=50,l=47               steps=500:3000:1000:4000:200:2500,hold=50000
+buck-3s-ramps       chem=lipo,cells=3,soc=50,l=47               steps=500:3000:1000:4000:200:2500,hold=20000,ramp=30000
+buck-3s-ramps-l22   chem=lipo,cells=3,soc=50,l=22               steps=500:3000:1000:4000:200:2500,hold=20000,ramp=30000
+boost-6s-steps      chem=lipo,cells=6,soc=50,l=47               steps=300:2000:600:1500,hold=50000
+boost-6s-ramps      chem=lipo,cells=6,soc=50,l=47               steps=300:2000:600:1500,hold=20000,ramp=30000
+buck-nimh-6s-ramps  chem=nimh,cells=6,soc=50,l=47               steps=500:2500:1000,hold=20000,ramp=30000
+"
+
+CHARGER="$1"
+FILTER="$2"
+if [ ! -x "$CHARGER" ]; then
+    echo "usage: $0 CHEALI_CHARGER [FILTER]"
+    exit 2
+fi
+MAX_ERROR="${MAX_ERROR:-2}"
+
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+result=0
+printf "%-20s %9s %9s %8s %9s %9s %8s\n" case "Q[mAh]" "plant" "err[%]" "E[Wh]" "plant" "err[%]"
+while read name plant profile; do
+    [ -z "$name" ] && continue
+    echo "$name" | grep -qE "${FILTER:-.}" || continue
+    line="$(CHEALI_EEPROM="$tmp/$name.eep" CHEALI_PLANT="$plant${PLANT:+,$PLANT}" CHEALI_SCENARIO="$profile" \
+        CHEALI_TIME_LIMIT=1200 CHEALI_LCD=0 CHEALI_REALTIME=0 "$CHARGER" < /dev/null 2>&1 > /dev/null \
+        | grep "^scenario: integration: " | tail -n 1)"
+    if [ -z "$line" ]; then
+        printf "%-20s did not end\n" "$name"
+        result=1
+        continue
+    fi
+    values="$(echo "$line" | sed -nE 's/.*charge ([0-9.]+)mAh \(Plant ([0-9.]+)mAh, ([-+0-9.]+)%\), energy ([0-9.]+)Wh \(Plant ([0-9.]+)Wh, ([-+0-9.]+)%\).*/\1 \2 \3 \4 \5 \6/p')"
+    read charge plantCharge chargeError energy plantEnergy energyError <<< "$values"
+    printf "%-20s %9.2f %9.2f %8.2f %9.4f %9.4f %8.2f\n" "$name" \
+        "$charge" "$plantCharge" "$chargeError" "$energy" "$plantEnergy" "$energyError"
+    if awk -v a="$chargeError" -v b="$energyError" -v m="$MAX_ERROR" \
+            'BEGIN { exit !(a > m || -a > m || b > m || -b > m) }'; then
+        result=1
+    fi
+done <<< "$CASES"
+exit $result
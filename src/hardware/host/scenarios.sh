@@ -0,0 +1,94 @@
+#!/bin/bash
+#
+# end-to-end program benchmark on the host (simulated battery)
+#
+# usage: scenarios.sh CHEALI_CHARGER [FILTER]
+#  e.g.: scenarios.sh build/cheali-charger lipo
+#
+# every scenario runs the real Program/Strategy code against the Plant
+# (CHEALI_PLANT, see generic/50W/Plant.h) with CHEALI_SCENARIO (see
+# generic/50W/Scenario.h), on a new eeprom (default settings). The table:
+# completion time, charge and energy in/out, final cell spread (OCV, SoC),
+# peak battery temperature, the time to reach the charge current (95% of the
+# set one, limited by the charger power; -1: never), the rms error of the
+# discharge current (-1: no discharge) and the stop reason ("-": completed).
+# FILTER: only the scenarios with a matching name (grep -E).
+#
+# environment:
+#  JOBS         parallel runs (default: nproc)
+#  TIME_LIMIT   virtual seconds per scenario (default: 43200)
+#
+# exit status: 1 if a scenario did not end (time limit, start info)
+
+# 6S: the boost is limited to 2 x Vin (MAX_PID_MV_FACTOR), vin 15V
+# name                  plant (CHEALI_PLANT)                                    scenario (CHEALI_SCENARIO)
+SCENARIOS="
+lipo-1s-charge          chem=lipo,cells=1,capacity=1000,soc=10                  program=charge
+lipo-2s-balcharge       chem=lipo,cells=2,capacity=1300,soc=20,imbalance=2      program=chargeBalance
+lipo-3s-balcharge       chem=lipo,cells=3,capacity=2200,soc=20,imbalance=3      program=chargeBalance
+lipo-3s-fastcharge      chem=lipo,cells=3,capacity=2200,soc=20,imbalance=3      program=fastCharge
+lipo-4s-balcharge       chem=lipo,cells=4,capacity=5000,soc=20,imbalance=3,r0=8 program=chargeBalance
+lipo-6s-balcharge       chem=lipo,cells=6,capacity=5000,soc=20,imbalance=3,r0=8,vin=15000 program=chargeBalance
+lipo-3s-storage         chem=lipo,cells=3,capacity=2200,soc=90,imbalance=3      program=storageBalance
+lipo-3s-balance         chem=lipo,cells=3,capacity=2200,soc=60,imbalance=5      program=balance
+lipo-3s-capacity        chem=lipo,cells=3,capacity=1000,soc=50,imbalance=2      program=capacityCheck,rest=1
+life-4s-balcharge       chem=life,cells=4,capacity=2300,soc=15,imbalance=3      program=chargeBalance
+nimh-8s-charge          chem=nimh,cells=8,capacity=2000,soc=10                  program=charge
+nimh-6s-dccycle         chem=nimh,cells=6,capacity=2000,soc=50                  program=dcCycle,cycles=1,rest=1
+lipo-3s-drift-dis       chem=lipo,cells=3,capacity=1000,soc=60,dgain=-8,dtc=-0.3 program=discharge
+pb-3s-charge            chem=pb,cells=3,capacity=4500,soc=30,r0=10              program=charge
+pb-6s-charge            chem=pb,cells=6,capacity=7000,soc=30,r0=5               program=charge
+"
+
+CHARGER="$1"
+FILTER="$2"
+if [ ! -x "$CHARGER" ]; then
+    echo "usage: $0 CHEALI_CHARGER [FILTER]"
+    exit 2
+fi
+JOBS="${JOBS:-$(nproc)}"
+TIME_LIMIT="${TIME_LIMIT:-43200}"
+
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+# result: "time charged energyIn discharged energyOut spreadV spreadSoC Tmax tIc idError stop"
+scenario()
+{
+    local name="$1" plant="$2" program="$3"
+    CHEALI_EEPROM="$tmp/$name.eep" CHEALI_PLANT="$plant" CHEALI_SCENARIO="$program" \
+        CHEALI_TIME_LIMIT="$TIME_LIMIT" CHEALI_LCD=0 CHEALI_REALTIME=0 \
+        "$CHARGER" < /dev/null > /dev/null 2> "$tmp/$name.log"
+    grep "^scenario: " "$tmp/$name.log" | tail -n 1 | sed -nE \
+        's/.*: time ([0-9.]+)s, charged ([0-9]+)mAh ([0-9.]+)Wh, discharged ([0-9]+)mAh ([0-9.]+)Wh, spread ([0-9.]+)mV ([0-9.]+)%, T max ([0-9.-]+)C, (Ic after .*)/\1 \2 \3 \4 \5 \6 \7 \8 \9/p' \
+        | sed -E 's/Ic after ([0-9.-]+)s, Id error ([0-9.-]+)mA, stop: /\1 \2 /' \
+        > "$tmp/$name.result"
+}
+
+names=
+while read name plant program; do
+    [ -z "$name" ] && continue
+    echo "$name" | grep -qE "${FILTER:-.}" || continue
+    names="$names $name"
+    while [ $(jobs -r | wc -l) -ge "$JOBS" ]; do
+        wait -n
+    done
+    scenario "$name" "$plant" "$program" &
+done <<< "$SCENARIOS"
+wait
+
+result=0
+printf "%-20s %9s %7s %7s %7s %7s %7s %6s %6s %6s %6s  %s\n" \
+    scenario "time[s]" "in[mAh]" "in[Wh]" "out[mAh]" "out[Wh]" "dV[mV]" "dSoC%" "T[C]" "tIc[s]" "dId[mA]" stop
+for name in $names; do
+    if [ -s "$tmp/$name.result" ]; then
+        read time charged energyIn discharged energyOut spreadV spreadSoC temperature tIc idError stop < "$tmp/$name.result"
+        printf "%-20s %9.1f %7d %7.2f %7d %7.2f %7.1f %6.2f %6.1f %6.1f %6.1f  %s\n" "$name" "$time" "$charged" "$energyIn" \
+            "$discharged" "$energyOut" "$spreadV" "$spreadSoC" "$temperature" "$tIc" "$idError" "$stop"
+    else
+        reason="$(grep "^scenario: " "$tmp/$name.log" | tail -n 1 | sed 's/^scenario: [^:]*: //')"
+        printf "%-20s did not end: %s\n" "$name" "${reason:-time limit}"
+        result=1
+    fi
+done
+exit $result
@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# step response of the SMPS current controller (SMPS_PID) on the host
+#
+# usage: steps.sh CHEALI_CHARGER [FILTER]
+#  e.g.: steps.sh build/cheali-charger boost
+#
+# every case runs CHEALI_SCENARIO=steps=... (see generic/50W/Scenario.h)
+# against the Plant (CHEALI_PLANT, see generic/50W/Plant.h), in the buck
+# and the boost region of the converter. The table: the worst step of the
+# case - 10-90% rise time, overshoot, settling time, the error and ripple
+# at the end of the step.
+# FILTER: only the cases with a matching name (grep -E).
+#
+# environment:
+#  STEPS        setpoints [mA] (default: 500:2000:5000:1000:3000:100)
+#  HOLD         ms per step (default: 300)
+#  PLANT        more plant options, e.g. the inductor ripple: l=47
+#
+# exit status: 1 if a case did not end
+
+# name              plant (CHEALI_PLANT)
+CASES="
+buck-1s             chem=lipo,cells=1,soc=50
+buck-3s             chem=lipo,cells=3,soc=50
+boost-4s            chem=lipo,cells=4,soc=50
+boost-6s-15v        chem=lipo,cells=6,soc=50,vin=15000
+buck-nimh-6s        chem=nimh,cells=6,soc=50
+boost-pb-6s         chem=pb,cells=6,soc=50,r0=5
+"
+
+CHARGER="$1"
+FILTER="$2"
+if [ ! -x "$CHARGER" ]; then
+    echo "usage: $0 CHEALI_CHARGER [FILTER]"
+    exit 2
+fi
+STEPS="${STEPS:-500:2000:5000:1000:3000:100}"
+HOLD="${HOLD:-300}"
+
+tmp="$(mktemp -d)"
+trap 'rm -rf "$tmp"' EXIT
+
+result=0
+printf "%-16s %8s %8s %8s %8s %8s\n" case "rise[ms]" "over[%]" "set[ms]" "err[mA]" "rip[mA]"
+while read name plant; do
+    [ -z "$name" ] && continue
+    echo "$name" | grep -qE "${FILTER:-.}" || continue
+    line="$(CHEALI_EEPROM="$tmp/$name.eep" CHEALI_PLANT="$plant${PLANT:+,$PLANT}" CHEALI_SCENARIO="steps=$STEPS,hold=$HOLD" \
+        CHEALI_TIME_LIMIT=600 CHEALI_LCD=0 CHEALI_REALTIME=0 "$CHARGER" < /dev/null 2>&1 > /dev/null \
+        | grep "^scenario: step: " | tail -n 1)"
+    if [ -z "$line" ]; then
+        printf "%-16s did not end\n" "$name"
+        result=1
+        continue
+    fi
+    echo "$line" | sed -nE 's/.*rise ([0-9.]+)ms, overshoot ([0-9.]+)%, settling ([0-9.]+)ms, error ([0-9.]+)mA, ripple ([0-9.]+)mA/\1 \2 \3 \4 \5/p' | {
+        read rise overshoot settling error ripple
+        printf "%-16s %8.1f %8.1f %8.1f %8.1f %8.1f\n" "$name" "$rise" "$overshoot" "$settling" "$error" "$ripple"
+    }
+done <<< "$CASES"
+exit $result
@@ -0,0 +1,256 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2013  Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ANALOG_INPUTS_ADC_SCHEDULE_H_
+#define ANALOG_INPUTS_ADC_SCHEDULE_H_
+
+#include "AnalogInputs.h"
+#include "Utils.h"
+
+/* ADC scan schedule, generated at compile time from a list of inputs:
+ *
+ * struct Inputs {
+ *     static constexpr adc_input list[] = { ... };
+ * };
+ * typedef AdcSchedule<Inputs> schedule;
+ *
+ * every input is converted weight_ times per ADC round, each conversion
+ * sums burst_ samples. The occurrences are spread evenly over the round.
+ * The next multiplexer address is set while the current conversion is running,
+ * so a multiplexer input always follows a not multiplexed full burst.
+ * At the end of a measurement i_avrSum_ is normalized to
+ * scale_ * (one ANALOG_INPUTS_ADC_BURST_COUNT burst per round).
+ * A trim_ input converts burst_ + 2 samples and drops the smallest and
+ * the biggest one (SMPS switching spikes), the sum still has burst_ samples.
+ * A sync_ input takes one sample per SMPS PWM period, at the same point of
+ * the current ripple (ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER, see
+ * AnalogInputsADCTrigger.h), trim_ is ignored.
+ */
+
+//a sync_ conversion of at least this many samples (PWM periods) takes about
+//as long as a full burst: long enough for the multiplexer to settle
+#ifndef ANALOG_INPUTS_ADC_SYNC_SETTLING
+#define ANALOG_INPUTS_ADC_SYNC_SETTLING     (ANALOG_INPUTS_ADC_BURST_COUNT/5)
+#endif
+
+namespace AnalogInputsADC {
+
+struct adc_input {
+    int8_t mux_;                //-1: not multiplexed
+    uint8_t adc_pin_;
+    AnalogInputs::Name ai_name_;
+    bool trigger_PID_;
+    uint8_t weight_;            //conversions per ADC round
+    uint8_t burst_;             //samples per conversion
+    uint8_t scale_;
+    bool trim_;                 //drop the smallest and the biggest sample
+    bool sync_;                 //one sample per SMPS PWM period
+};
+
+//one ADC schedule slot
+struct adc_correlation {
+    int8_t mux_;
+    uint8_t adc_pin_;
+    AnalogInputs::Name ai_name_;
+    bool trigger_PID_;
+    uint8_t burst_;             //converted samples (summed, with trim_: minus min and max)
+    bool trim_;
+    bool sync_;
+};
+
+//i_avrSum_[name_] = i_avrSum_[name_] / divider_ * multiplier_
+struct adc_normalization {
+    AnalogInputs::Name name_;
+    uint16_t divider_;
+    uint16_t multiplier_;
+};
+
+namespace schedule {
+
+    template<uint8_t... I> struct Indices {};
+    template<uint8_t N, uint8_t... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+    template<uint8_t... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+    constexpr bool isMux(const adc_input &a) { return a.mux_ >= 0; }
+
+    constexpr uint8_t muxWeight(const adc_input *in, uint8_t n) {
+        return n == 0 ? 0 : (isMux(in[0]) ? in[0].weight_ : 0) + muxWeight(in + 1, n - 1);
+    }
+    constexpr uint8_t slots(const adc_input *in, uint8_t n) {
+        return n == 0 ? 0 : in[0].weight_ + slots(in + 1, n - 1);
+    }
+
+    //level 0: not multiplexed inputs, level 1: multiplexer inputs
+    constexpr uint8_t weight(const adc_input *in, uint8_t n, uint8_t level, uint8_t e) {
+        return e < n && isMux(in[e]) == (level == 1) ? in[e].weight_ : 0;
+    }
+
+    //inputs on the level before e
+    constexpr uint8_t levelIndex(const adc_input *in, uint8_t n, uint8_t level, uint8_t e) {
+        return e == 0 ? 0 : (weight(in, n, level, e - 1) > 0) + levelIndex(in, n, level, e - 1);
+    }
+
+    //stride scheduling: occurrence m of the i-th input (out of c) is placed
+    //at (m + (i + 1/2)/c) / weight of the round
+    constexpr uint32_t position(uint8_t c, uint8_t i, uint8_t m) {
+        return 2*(uint32_t(m)*c + i) + 1;
+    }
+
+    constexpr bool before(uint8_t c, uint8_t we, uint8_t ie, uint8_t m, uint8_t wf, uint8_t iff, uint8_t k) {
+        return position(c, ie, m) * wf < position(c, iff, k) * we
+            || (position(c, ie, m) * wf == position(c, iff, k) * we && ie < iff);
+    }
+
+    constexpr uint8_t countBefore(uint8_t c, uint8_t wf, uint8_t iff, uint8_t k, uint8_t we, uint8_t ie, uint8_t m) {
+        return k >= wf ? 0 : before(c, wf, iff, k, we, ie, m) + countBefore(c, wf, iff, k + 1, we, ie, m);
+    }
+
+    constexpr uint8_t rank(const adc_input *in, uint8_t n, uint8_t level, uint8_t e, uint8_t m, uint8_t f = 0) {
+        return f >= n ? 0
+            : countBefore(levelIndex(in, n, level, n), weight(in, n, level, f), levelIndex(in, n, level, f), 0,
+                    weight(in, n, level, e), levelIndex(in, n, level, e), m)
+                + rank(in, n, level, e, m, f + 1);
+    }
+
+    //input with the r-th occurrence on the given level
+    constexpr uint8_t find(const adc_input *in, uint8_t n, uint8_t level, uint8_t r, uint8_t e = 0, uint8_t m = 0) {
+        return e >= n ? 0xff
+            : m >= weight(in, n, level, e) ? find(in, n, level, r, e + 1, 0)
+            : rank(in, n, level, e, m) == r ? e
+            : find(in, n, level, r, e, m + 1);
+    }
+
+    constexpr bool fullBurst(const adc_input &a) {
+        return a.burst_ == ANALOG_INPUTS_ADC_BURST_COUNT || (a.sync_ && a.burst_ >= ANALOG_INPUTS_ADC_SYNC_SETTLING);
+    }
+
+    //not multiplexed inputs (in direct order) before position p, which take
+    //long enough for the multiplexer to settle
+    constexpr uint8_t settlesBefore(const adc_input *in, const uint8_t *direct, uint8_t p) {
+        return p == 0 ? 0 : fullBurst(in[direct[p - 1]]) + settlesBefore(in, direct, p - 1);
+    }
+
+    //the not multiplexed inputs are placed first, the g-th multiplexer input goes
+    //after the gap(g)-th of them which takes long enough for the multiplexer to settle
+    constexpr uint8_t gap(uint8_t settling, uint8_t mux, uint8_t g) {
+        return uint16_t(2*g + 1) * settling / (2*mux);
+    }
+
+    constexpr uint8_t muxBefore(uint8_t settling, uint8_t mux, uint8_t s, uint8_t g = 0) {
+        return g >= mux || gap(settling, mux, g) >= s ? g : muxBefore(settling, mux, s, g + 1);
+    }
+
+    //number of multiplexer inputs before the p-th not multiplexed input
+    constexpr uint8_t muxBefore(const adc_input *in, const uint8_t *direct, uint8_t directs, uint8_t mux, uint8_t p) {
+        return muxBefore(settlesBefore(in, direct, directs), mux, settlesBefore(in, direct, p));
+    }
+
+    constexpr uint8_t slotInput(const adc_input *in, const uint8_t *direct, uint8_t directs,
+            const uint8_t *mux, uint8_t muxes, uint8_t slot, uint8_t p = 0) {
+        return p >= directs ? 0xff
+            : p + muxBefore(in, direct, directs, muxes, p) == slot ? direct[p]
+            : p + muxBefore(in, direct, directs, muxes, p) + 1 == slot
+                && muxBefore(in, direct, directs, muxes, p + 1) > muxBefore(in, direct, directs, muxes, p)
+                ? mux[muxBefore(in, direct, directs, muxes, p)]
+            : slotInput(in, direct, directs, mux, muxes, slot, p + 1);
+    }
+
+    //a multiplexer input has to follow a full burst (the address is set when it starts)
+    constexpr bool muxSettles(const adc_input *in, const uint8_t *order, uint8_t slots, uint8_t slot = 0) {
+        return slot >= slots ? true
+            : !(isMux(in[order[(slot + 1) % slots]])
+                && (isMux(in[order[slot]]) || !fullBurst(in[order[slot]])))
+                && muxSettles(in, order, slots, slot + 1);
+    }
+
+    constexpr bool burstsValid(const adc_input *in, uint8_t n) {
+        return n == 0 ? true
+            : in[0].burst_ > 0 && ANALOG_INPUTS_ADC_BURST_COUNT % in[0].burst_ == 0
+                && uint64_t(in[0].weight_) * in[0].burst_ * ANALOG_INPUTS_ADC_ROUND_MAX_COUNT * 0xffff <= 0xffffffffUL
+                && burstsValid(in + 1, n - 1);
+    }
+
+    constexpr uint16_t gcd(uint16_t a, uint16_t b) { return b == 0 ? a : gcd(b, a % b); }
+
+    constexpr adc_correlation slotEntry(const adc_input &a) {
+        return adc_correlation{a.mux_, a.adc_pin_, a.ai_name_, a.trigger_PID_,
+            uint8_t(a.trim_ && !a.sync_ ? a.burst_ + 2 : a.burst_), a.trim_ && !a.sync_, a.sync_};
+    }
+
+    constexpr adc_normalization normalization(const adc_input &a) {
+        return adc_normalization{a.ai_name_,
+            uint16_t(a.weight_ * a.burst_ / gcd(a.weight_ * a.burst_, a.scale_ * ANALOG_INPUTS_ADC_BURST_COUNT)),
+            uint16_t(a.scale_ * ANALOG_INPUTS_ADC_BURST_COUNT / gcd(a.weight_ * a.burst_, a.scale_ * ANALOG_INPUTS_ADC_BURST_COUNT))};
+    }
+
+    template<class Inputs, class Slots, class InputIndices, class Directs, class Muxes> struct Tables;
+
+    template<class Inputs, uint8_t... S, uint8_t... I, uint8_t... D, uint8_t... M>
+    struct Tables<Inputs, Indices<S...>, Indices<I...>, Indices<D...>, Indices<M...> > {
+        static constexpr uint8_t direct[sizeof...(D)] = { find(Inputs::list, sizeof...(I), 0, D)... };
+        static constexpr uint8_t mux[sizeof...(M)] = { find(Inputs::list, sizeof...(I), 1, M)... };
+        static constexpr uint8_t slotInputs[sizeof...(S)] = {
+            slotInput(Inputs::list, direct, sizeof...(D), mux, sizeof...(M), S)...
+        };
+        static const adc_correlation order[sizeof...(S)];
+        static const adc_normalization normalize[sizeof...(I)];
+
+        STATIC_ASSERT_MSG(sizeof...(M) > 0 && sizeof...(M) <= settlesBefore(Inputs::list, direct, sizeof...(D)),
+                "not enough full burst conversions to separate multiplexer inputs");
+        STATIC_ASSERT_MSG(muxSettles(Inputs::list, slotInputs, sizeof...(S)),
+                "multiplexer input does not follow a full burst");
+    };
+
+    template<class Inputs, uint8_t... S, uint8_t... I, uint8_t... D, uint8_t... M>
+    constexpr uint8_t Tables<Inputs, Indices<S...>, Indices<I...>, Indices<D...>, Indices<M...> >::direct[sizeof...(D)];
+    template<class Inputs, uint8_t... S, uint8_t... I, uint8_t... D, uint8_t... M>
+    constexpr uint8_t Tables<Inputs, Indices<S...>, Indices<I...>, Indices<D...>, Indices<M...> >::mux[sizeof...(M)];
+    template<class Inputs, uint8_t... S, uint8_t... I, uint8_t... D, uint8_t... M>
+    constexpr uint8_t Tables<Inputs, Indices<S...>, Indices<I...>, Indices<D...>, Indices<M...> >::slotInputs[sizeof...(S)];
+
+    template<class Inputs, uint8_t... S, uint8_t... I, uint8_t... D, uint8_t... M>
+    const adc_correlation Tables<Inputs, Indices<S...>, Indices<I...>, Indices<D...>, Indices<M...> >::order[sizeof...(S)] = {
+        slotEntry(Inputs::list[slotInputs[S]])...
+    };
+
+    template<class Inputs, uint8_t... S, uint8_t... I, uint8_t... D, uint8_t... M>
+    const adc_normalization Tables<Inputs, Indices<S...>, Indices<I...>, Indices<D...>, Indices<M...> >::normalize[sizeof...(I)] = {
+        normalization(Inputs::list[I])...
+    };
+
+} // namespace schedule
+
+#define ADC_SCHEDULE_SLOTS(Inputs)  schedule::slots(Inputs::list, sizeOfArray(Inputs::list))
+#define ADC_SCHEDULE_MUXES(Inputs)  schedule::muxWeight(Inputs::list, sizeOfArray(Inputs::list))
+
+template<class Inputs>
+struct AdcSchedule : schedule::Tables<Inputs,
+        typename schedule::MakeIndices<ADC_SCHEDULE_SLOTS(Inputs)>::type,
+        typename schedule::MakeIndices<sizeOfArray(Inputs::list)>::type,
+        typename schedule::MakeIndices<ADC_SCHEDULE_SLOTS(Inputs) - ADC_SCHEDULE_MUXES(Inputs)>::type,
+        typename schedule::MakeIndices<ADC_SCHEDULE_MUXES(Inputs)>::type> {
+
+    static const uint8_t INPUTS = sizeOfArray(Inputs::list);
+    static const uint8_t SLOTS = ADC_SCHEDULE_SLOTS(Inputs);
+
+    STATIC_ASSERT_MSG(schedule::burstsValid(Inputs::list, INPUTS),
+            "burst_ must divide ANALOG_INPUTS_ADC_BURST_COUNT and the sum must fit into uint32_t");
+};
+
+} // namespace AnalogInputsADC
+
+#endif /* ANALOG_INPUTS_ADC_SCHEDULE_H_ */
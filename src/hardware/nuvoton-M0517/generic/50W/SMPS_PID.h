@@ -15,13 +15,92 @@
 #define PID_MV_PRECISION 8
 #define MAX_PID_MV_PRECISION (((uint32_t) MAX_PID_MV)<<PID_MV_PRECISION)
 
+#if defined(ENABLE_SMPS_FEED_FORWARD) && !defined(ENABLE_SMPS_PID)
+#error "ENABLE_SMPS_FEED_FORWARD needs ENABLE_SMPS_PID"
+#endif
+
+#ifdef ENABLE_SMPS_PID
+//PI(D) gains (ENABLE_SMPS_PID): MV << PID_MV_PRECISION per Ismps ADC unit (error),
+//the D part is on the measurement (no kick on a setpoint change), 0 - off.
+//The boost region (MV > OUTPUT_PWM_PRECISION_PERIOD) has a higher loop gain:
+//dVout/dMV = Vin/(1-D)^2 instead of Vin.
+//Tuned on the host Plant: CHEALI_SCENARIO=steps=... (see Scenario.h)
+#ifndef PID_KP_BUCK
+#define PID_KP_BUCK     4
+#endif
+#ifndef PID_KI_BUCK
+#define PID_KI_BUCK     8
+#endif
+#ifndef PID_KD_BUCK
+#define PID_KD_BUCK     0
+#endif
+#ifndef PID_KP_BOOST
+#define PID_KP_BOOST    3
+#endif
+#ifndef PID_KI_BOOST
+#define PID_KI_BOOST    4
+#endif
+#ifndef PID_KD_BOOST
+#define PID_KD_BOOST    0
+#endif
+#else
+//I only loop: MV += error*PID_KI (MV << PID_MV_PRECISION, error in Ismps ADC units)
+#ifndef PID_KI
+#define PID_KI          4
+#endif
+#endif
+
+//feed-forward (ENABLE_SMPS_FEED_FORWARD): Rth [mOhm] - the resistance
+//between the ideal converter output and the battery EMF, it is learned
+//from the MV of two settled currents (at least SMPS_FF_RTH_MIN_DELTA_I apart)
+#ifndef SMPS_FF_RTH_DEFAULT
+#define SMPS_FF_RTH_DEFAULT         150
+#endif
+#define SMPS_FF_RTH_MIN             20
+#define SMPS_FF_RTH_MAX             2000
+#define SMPS_FF_RTH_MIN_DELTA_I     ANALOG_AMP(0.200)
+//PID updates without the P and I part after a preload
+#ifndef SMPS_FF_HOLD
+#define SMPS_FF_HOLD                4
+#endif
+//settled: SMPS_FF_SETTLED_COUNT PID updates in a row (after the hold) with
+//|error| <= setpoint/2^SMPS_FF_SETTLED_SHIFT + SMPS_FF_SETTLED_ERROR [Ismps ADC]
+#ifndef SMPS_FF_SETTLED_ERROR
+#define SMPS_FF_SETTLED_ERROR       64
+#endif
+#define SMPS_FF_SETTLED_SHIFT       6
+#define SMPS_FF_SETTLED_COUNT       32
+
+//discharger current loop (ENABLE_DISCHARGER_PID): run after every Idischarge
+//conversion, it scales the PWM of the calibration (IdischargeSet) by a gain:
+//the calibration error and the drift (temperature, battery voltage).
+//The gain changes by 1/2^DISCHARGER_PID_KI_SHIFT of the relative error
+//per update, within DISCHARGER_PID_GAIN_MIN - DISCHARGER_PID_GAIN_MAX
+#define DISCHARGER_PID_GAIN_PRECISION   16
+#define DISCHARGER_PID_GAIN_ONE         (1L << DISCHARGER_PID_GAIN_PRECISION)
+#ifndef DISCHARGER_PID_KI_SHIFT
+#define DISCHARGER_PID_KI_SHIFT         2
+#endif
+#define DISCHARGER_PID_GAIN_MIN         (DISCHARGER_PID_GAIN_ONE * 3 / 4)
+#define DISCHARGER_PID_GAIN_MAX         (DISCHARGER_PID_GAIN_ONE * 5 / 4)
+//updates skipped after a new value
+#define DISCHARGER_PID_HOLD             1
+
 namespace SMPS_PID
 {
     void init(uint16_t Vin, uint16_t Vout);
+    //MV of the converter with Vout on the output and no current
+    uint16_t getFeedForward(uint16_t Vin, uint16_t Vout);
+    //Vout of an ideal converter with MV
+    uint32_t getIdealVout(uint16_t Vin, uint16_t MV);
     void setPID_MV(uint16_t value);
     void powerOn();
     void powerOff();
     void update();
+#ifdef ENABLE_DISCHARGER_PID
+    //adc: the mean of the Idischarge burst (getADCValue() units)
+    void updateDischarger(uint16_t adc);
+#endif
 };
 
 #endif //SMPS_PID_H_
@@ -43,6 +43,10 @@ namespace hardware {
 
     void setChargerValue(uint16_t value);
     void setDischargerValue(uint16_t value);
+#ifdef ENABLE_DISCHARGER_PID
+    //the Idischarge (ADC) the discharger loop holds, 0: open loop (the value)
+    void setDischargerTarget(uint16_t Idischarge);
+#endif
     void setVoutCutoff(AnalogInputs::ValueType v);
 
     void setBalancer(uint8_t balance);
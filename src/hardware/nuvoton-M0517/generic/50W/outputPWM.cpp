@@ -18,6 +18,7 @@
 
 #include "LcdPrint.h"
 #include "outputPWM.h"
+#include "outputPWMModulator.h"
 #include "irq_priority.h"
 
 //#define ENABLE_DEBUG
@@ -39,24 +40,21 @@ volatile uint32_t pwm_n;
 
 volatile uint32_t PWM_valueA = 0;
 volatile uint32_t PWM_valueB = 0;
-volatile uint32_t PWM_sumA = 0;
-volatile uint32_t PWM_sumB = 0;
+Modulator PWM_modulatorA;
+Modulator PWM_modulatorB;
 
 void setCMR() {
     //modulate the PWM - we modulate the PWM signal to get more precision.
-    //(the PWM frequency stays at about 32kHz)
-    PWM_sumA+=PWM_valueA;
-    PWM_sumB+=PWM_valueB;
-
-    PWM_SET_CMR(PWMA, PWM_CH1, PWM_sumA/OUTPUT_PWM_PRECISION_FACTOR);
-    PWM_SET_CMR(PWMB, PWM_CH2, PWM_sumB/OUTPUT_PWM_PRECISION_FACTOR);
-
-    PWM_sumA%=OUTPUT_PWM_PRECISION_FACTOR;
-    PWM_sumB%=OUTPUT_PWM_PRECISION_FACTOR;
+    //(the PWM frequency stays at about 32kHz, see outputPWMModulator.h)
+    PWM_SET_CMR(PWMA, PWM_CH1, PWM_modulatorA.next(PWM_valueA));
+    PWM_SET_CMR(PWMB, PWM_CH2, PWM_modulatorB.next(PWM_valueB));
 }
 
 void initialize(void)
 {
+    PWM_modulatorA.reset();
+    PWM_modulatorB.reset();
+
     CLK_EnableModuleClock(PWM01_MODULE);
     CLK_EnableModuleClock(PWM67_MODULE);
 
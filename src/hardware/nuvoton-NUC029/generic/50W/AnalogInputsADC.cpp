@@ -28,6 +28,13 @@
 #include "SMPS.h"
 #include "Discharger.h"
 #include "irq_priority.h"
+#include "AnalogInputsADCSchedule.h"
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+#include "outputPWM.h"
+#endif
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+#include "AnalogInputsNoise.h"
+#endif
 
 #include "adc.h"
 
@@ -54,12 +61,15 @@
  * ...
  *
  * note: 1-4 are in setMuxAddress()
- * note: for each ADC pin (start ADC) we do 70 measurements,
- *       all in all we do 70*100=7000 measurements for a "fullMeasurement" per input.
+ * note: a sync_ input (ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER) is not a burst:
+ *       every conversion is started by the SMPS PWM (single mode),
+ *       the result is in its own channel register
+ * note: for each ADC pin (start ADC) we do up to 70 measurements,
+ *       all in all we do 70*100=7000 measurements for a "fullMeasurement" per input
+ *       (see AnalogInputsADCSchedule.h)
  */
 
 
-#define ADC_I_SMPS_PER_ROUND 4
 //discharge ADC capacitor on Vb6 - there is an operational amplifier
 #define ADC_CAPACITOR_DISCHARGE_ADDRESS MADDR_V_BALANSER6
 #define ADC_CAPACITOR_DISCHARGE_DELAY_US 20
@@ -68,11 +78,19 @@
 
 
 volatile uint8_t g_adcBurstCount = 0;
+volatile uint8_t g_adcBurstLength = 0;
 volatile uint8_t g_adcInputName = 0;
 volatile uint8_t g_muxAddress = 0;
 volatile uint8_t g_addSumToInput = 0;
 volatile uint32_t g_adcSum = 0;
 volatile uint32_t g_adcValue = 0;
+volatile uint16_t g_adcMin = 0;
+volatile uint16_t g_adcMax = 0;
+volatile bool g_adcTrim = false;
+volatile uint8_t g_adcChannel = 0;
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+volatile bool g_adcSync = false;
+#endif
 
 
 
@@ -84,45 +102,41 @@ void startConversion();
 
 
 
-struct adc_correlation {
-    int8_t mux_;
-    uint8_t adc_pin_;
-    AnalogInputs::Name ai_name_;
-    bool trigger_PID_;
-};
-
-const adc_correlation order_analogInputs_on[] PROGMEM = {
-    //{MADDR_V_BALANSER_BATT_MINUS,   MUX0_Z_D_PIN,           AnalogInputs::Vb0_pin,         false},
-	//{-1,                            OUTPUT_V_BALANSER_BATT_MINUS,AnalogInputs::Vb0_pin,         false},
-	//{-1,                            OUTPUT_VOLTAGE_MINUS_PIN,AnalogInputs::Vout_minus_pin, false},
-	{MADDR_V_BALANSER_BATT_MINUS	,MUX0_Z_D_PIN,   AnalogInputs::Vb0_pin, false},
-    {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,           true},
-	{MADDR_V_BALANSER_BATT_MINUS	,MUX0_Z_D_PIN,   AnalogInputs::Vout_minus_pin, false},
-    {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,           true},
-    {MADDR_V_BALANSER1,             MUX0_Z_D_PIN,           AnalogInputs::Vb1_pin,         false},
-    {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,           true},
-    {MADDR_V_BALANSER2,             MUX0_Z_D_PIN,           AnalogInputs::Vb2_pin,         false},
-    {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,           true},
-    {MADDR_V_OUTPUT_VOLTAGE_PLUS_PIN, MUX0_Z_D_PIN,         AnalogInputs::Vout_plus_pin,   false},
-    {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,           true},
-    {MADDR_V_BALANSER6,             MUX0_Z_D_PIN,           AnalogInputs::Vb6_pin,         false},
-    {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,           true},
-    {MADDR_V_BALANSER5,             MUX0_Z_D_PIN,           AnalogInputs::Vb5_pin,         false},
-    {-1,                            DISCHARGE_CURRENT_PIN,   AnalogInputs::Idischarge,      false},
-    {MADDR_V_BALANSER4,             MUX0_Z_D_PIN,           AnalogInputs::Vb4_pin,         false},
-    {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,           true},
-    {MADDR_V_BALANSER3,             MUX0_Z_D_PIN,           AnalogInputs::Vb3_pin,         false},
-    {-1,                            V_IN_PIN,               AnalogInputs::Vin,             false},
-    {-1,                            T_EXTERNAL_PIN,         AnalogInputs::Textern,         false},
-    {-1,                            T_INTERNAL_PIN,         AnalogInputs::Tintern,         false},
-    {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,           true},
+//Ismps is converted 8 times per round, its sum is divided by 4 (scale_ 2),
+//the default calibration depends on it
+//Vin and Tintern change slowly, their ADC time goes to the other inputs
+//Ismps and Vout_plus_pin see the SMPS switching spikes: trim_
+struct adc_inputs {
+    static constexpr adc_input list[] = {
+        //mux_,                         adc_pin_,               ai_name_,                       trigger_PID_, weight_, burst_, scale_, trim_, sync_
+        {MADDR_V_BALANSER_BATT_MINUS,   MUX0_Z_D_PIN,           AnalogInputs::Vb0_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER_BATT_MINUS,   MUX0_Z_D_PIN,           AnalogInputs::Vout_minus_pin,   false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER1,             MUX0_Z_D_PIN,           AnalogInputs::Vb1_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER2,             MUX0_Z_D_PIN,           AnalogInputs::Vb2_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_OUTPUT_VOLTAGE_PLUS_PIN, MUX0_Z_D_PIN,         AnalogInputs::Vout_plus_pin,    false,  1,  70, 1, true, false},
+        {MADDR_V_BALANSER6,             MUX0_Z_D_PIN,           AnalogInputs::Vb6_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER5,             MUX0_Z_D_PIN,           AnalogInputs::Vb5_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER4,             MUX0_Z_D_PIN,           AnalogInputs::Vb4_pin,          false,  1,  70, 1, false, false},
+        {MADDR_V_BALANSER3,             MUX0_Z_D_PIN,           AnalogInputs::Vb3_pin,          false,  1,  70, 1, false, false},
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+        {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,            true,   8,  14, ANALOG_INPUTS_ADC_SCALE_Ismps, false, true},
+#else
+        {-1,                            SMPS_CURRENT_PIN,       AnalogInputs::Ismps,            true,   8,  70, ANALOG_INPUTS_ADC_SCALE_Ismps, true, false},
+#endif
+        {-1,                            DISCHARGE_CURRENT_PIN,  AnalogInputs::Idischarge,       false,  1,  70, 1, false, false},
+        {-1,                            V_IN_PIN,               AnalogInputs::Vin,              false,  1,  14, 1, false, false},
+        {-1,                            T_EXTERNAL_PIN,         AnalogInputs::Textern,          false,  1,  70, 1, false, false},
+        {-1,                            T_INTERNAL_PIN,         AnalogInputs::Tintern,          false,  1,  14, 1, false, false},
+    };
 };
+constexpr adc_input adc_inputs::list[];
 
+typedef AdcSchedule<adc_inputs> schedule_;
 
 
 inline uint8_t nextInput(uint8_t i) {
     i++;
-    if(i >= sizeOfArray(order_analogInputs_on)) i=0;
+    if(i >= schedule_::SLOTS) i=0;
     return i;
 }
 
@@ -224,7 +238,7 @@ void initialize()
 void setNextMuxAddress()
 {
     uint8_t next_input = nextInput(current_input_);
-    int8_t mux = order_analogInputs_on[next_input].mux_;
+    int8_t mux = schedule_::order[next_input].mux_;
 
     setMuxAddressAndDischarge(mux);
 }
@@ -234,19 +248,45 @@ void startConversion()
 {
     setNextMuxAddress();
 
-    g_adcInputName = order_analogInputs_on[current_input_].ai_name_;
+    g_adcInputName = schedule_::order[current_input_].ai_name_;
     g_adcBurstCount = 0;
+    g_adcBurstLength = schedule_::order[current_input_].burst_;
+    g_adcTrim = schedule_::order[current_input_].trim_;
     g_adcSum = 0;
-    uint8_t adc_pin = order_analogInputs_on[current_input_].adc_pin_;
+    g_adcMin = 0xffff;
+    g_adcMax = 0;
+    uint8_t adc_pin = schedule_::order[current_input_].adc_pin_;
     setADC(adc_pin);
     if(adc_pin > 64) {
         ADC_CONFIG_CH7(ADC, (adc_pin >> 6) << ADC_ADCHER_PRESEL_Pos);
     } else {
         ADC_CONFIG_CH7(ADC, ADC_ADCHER_PRESEL_EXT_INPUT_SIGNAL);
     }
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+    g_adcSync = schedule_::order[current_input_].sync_;
+    if(g_adcSync) {
+        //no warm-up samples: the input is sampled once per PWM period
+        g_adcBurstCount = 2;
+        g_adcChannel = IO::getADCChannel(adc_pin);
+        ADC->ADCR = (ADC->ADCR & ~ADC_ADCR_ADMD_Msk) | ADC_ADCR_ADMD_SINGLE;
+        ADC_EnableHWTrigger(ADC, ADC_ADCR_TRGS_PWM, 0);
+        outputPWM::enableADCTrigger(true);
+        return;
+    }
+#endif
     ADC_START_CONV(ADC);
 }
 
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+void stopSync()
+{
+    outputPWM::enableADCTrigger(false);
+    ADC_DisableHWTrigger(ADC);
+    ADC->ADCR = (ADC->ADCR & ~ADC_ADCR_ADMD_Msk) | ADC_ADCR_ADMD_BURST;
+    g_adcChannel = 0;
+}
+#endif
+
 void finalizeMeasurement();
 
 #define ADC_GET_CONVERSION_DATA2(adc, u32ChNum) ((inpw(&(ADC->ADDR[(u32ChNum)])) & ADC_ADDR_RSLT_Msk)>>ADC_ADDR_RSLT_Pos)
@@ -259,6 +299,10 @@ void conversionDone()
     while(ADC_IS_BUSY2(ADC));
     while(ADC_IS_DATA_VALID2(ADC, 0)) ADC_GET_CONVERSION_DATA2(ADC, 0);
 
+#ifdef ENABLE_DISCHARGER_PID
+    if(schedule_::order[current_input_].ai_name_ == AnalogInputs::Idischarge)
+        SMPS_PID::updateDischarger((g_adcSum << 4) / (g_adcBurstLength - (g_adcTrim ? 2 : 0)));
+#endif
     current_input_ = nextInput(current_input_);
 
     if(current_input_ == 0) {
@@ -267,7 +311,7 @@ void conversionDone()
     }
     startConversion();
 
-    if(order_analogInputs_on[current_input_].trigger_PID_)
+    if(schedule_::order[current_input_].trigger_PID_)
         SMPS_PID::update();
 
 
@@ -278,11 +322,28 @@ void finalizeMeasurement()
     AnalogInputs::i_adc_[AnalogInputs::IsmpsSet]        = SMPS::getValue();
     AnalogInputs::i_adc_[AnalogInputs::IdischargeSet]   = Discharger::getValue();
 
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+    for(uint8_t i = 0; i < schedule_::INPUTS; i++) {
+        const adc_normalization &n = schedule_::normalize[i];
+        if(n.name_ <= AnalogInputs::Idischarge) {
+            uint32_t v = AnalogInputs::i_roundSum_[n.name_];
+            AnalogInputs::i_roundSum_[n.name_] = v / n.divider_ * n.multiplier_;
+        }
+    }
+    AnalogInputs::intterruptIntegrate();
+#endif
+
     if(g_addSumToInput) {
         AnalogInputs::i_avrSum_[AnalogInputs::IsmpsSet]        += SMPS::getValue() * ANALOG_INPUTS_ADC_BURST_COUNT;
         AnalogInputs::i_avrSum_[AnalogInputs::IdischargeSet]   += Discharger::getValue() * ANALOG_INPUTS_ADC_BURST_COUNT;
         if(AnalogInputs::i_avrCount_ == 1) {
-            AnalogInputs::i_avrSum_[AnalogInputs::Ismps]          /= ADC_I_SMPS_PER_ROUND;
+            for(uint8_t i = 0; i < schedule_::INPUTS; i++) {
+                const adc_normalization &n = schedule_::normalize[i];
+                if(n.divider_ != 1 || n.multiplier_ != 1) {
+                    uint32_t v = AnalogInputs::i_avrSum_[n.name_];
+                    AnalogInputs::i_avrSum_[n.name_] = v / n.divider_ * n.multiplier_;
+                }
+            }
         }
         //TODO: maybe intterruptFinalizeMeasurement should be removed
         AnalogInputs::intterruptFinalizeMeasurement();
@@ -301,19 +362,35 @@ extern "C" {
 
     void ADC_IRQHandler(void)
     {
-        while(ADC_IS_DATA_VALID2(ADC, 0)) /* Check the VALID bits */
+        while(ADC_IS_DATA_VALID2(ADC, g_adcChannel)) /* Check the VALID bits */
         {
             /* In burst mode, the software always gets the conversion result of the specified channel from channel 0 */
-            g_adcValue = ADC_GET_CONVERSION_DATA2(ADC, 0);
+            g_adcValue = ADC_GET_CONVERSION_DATA2(ADC, g_adcChannel);
             if(g_adcBurstCount > 1) {
                 g_adcSum += g_adcValue;
+                //fixed cost: two compares per sample
+                if(g_adcValue < g_adcMin) g_adcMin = g_adcValue;
+                if(g_adcValue > g_adcMax) g_adcMax = g_adcValue;
+#ifdef ENABLE_ANALOG_INPUTS_NOISE
+                AnalogInputsNoise::intterruptSample(g_adcInputName, g_adcValue);
+#endif
             }
-            if(++g_adcBurstCount > ANALOG_INPUTS_ADC_BURST_COUNT+1) {
+            if(++g_adcBurstCount > g_adcBurstLength+1) {
                 ADC_STOP_CONV(ADC);
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+                if(g_adcSync)
+                    AnalogInputsADC::stopSync();
+#endif
+                if(g_adcTrim)
+                    g_adcSum -= g_adcMin + g_adcMax;
                 // pretend 16bit adc
                 AnalogInputs::i_adc_[g_adcInputName] = g_adcValue << 4;
                 if(g_addSumToInput)
                     AnalogInputs::i_avrSum_[g_adcInputName] += g_adcSum << 4;
+#ifdef ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
+                if(g_adcInputName <= AnalogInputs::Idischarge)
+                    AnalogInputs::i_roundSum_[g_adcInputName] += g_adcSum << 4;
+#endif
                 AnalogInputsADC::conversionDone();
                 break;
             }
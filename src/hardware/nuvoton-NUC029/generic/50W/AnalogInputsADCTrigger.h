@@ -0,0 +1,79 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ANALOG_INPUTS_ADC_TRIGGER_H_
+#define ANALOG_INPUTS_ADC_TRIGGER_H_
+
+#include <stdint.h>
+#include "outputPWM.h"
+
+/* PWM synchronised ADC sampling (ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER)
+ *
+ * the PWM counts down from OUTPUT_PWM_PERIOD to 0, the output is on from
+ * the CMR match to the end of the period: the SMPS current ramps up for
+ * CMR+1 clocks and down for the rest. The current in the middle of a ramp
+ * is the average one. A sync_ input (see AnalogInputsADCSchedule.h) is
+ * started by the SMPS PWM channel (buck or boost, the one that switches)
+ * in the middle of its longer ramp, the farthest from the switching edges:
+ * the duty (CMR match) or the period (counter 0) trigger plus a delay.
+ * The delay follows the CMR in the PWM interrupt (setCMR).
+ */
+
+//PWM clock: HCLK/2 (50MHz), OUTPUT_PWM_PERIOD+1 clocks - 32kHz
+#define ADC_TRIGGER_PWM_CLOCK_NS        40
+//trigger delay unit (ADTDCR.PTDT): 4 HCLK
+#define ADC_TRIGGER_DELAY_PWM_CLOCKS    2
+#define ADC_TRIGGER_MAX_DELAY           255
+//the ADC samples the input for ~1us after the start (4 ADC clocks),
+//the middle of it is placed in the middle of the ramp
+#define ADC_TRIGGER_SAMPLING_PWM_CLOCKS 25
+
+namespace AnalogInputsADCTrigger {
+
+struct Trigger {
+    bool period;        //false: the duty trigger (CMR match), true: the period trigger (counter 0)
+    uint8_t delay;      //ADTDCR.PTDT
+};
+
+inline Trigger get(uint16_t cmr)
+{
+    if(cmr > OUTPUT_PWM_PERIOD)
+        cmr = OUTPUT_PWM_PERIOD;
+    uint16_t on = cmr + 1;
+    uint16_t off = OUTPUT_PWM_PERIOD - cmr;
+    Trigger t;
+    t.period = off > on;
+    uint16_t clocks = (t.period ? off : on) / 2;
+    clocks = clocks > ADC_TRIGGER_SAMPLING_PWM_CLOCKS/2 ? clocks - ADC_TRIGGER_SAMPLING_PWM_CLOCKS/2 : 0;
+    clocks /= ADC_TRIGGER_DELAY_PWM_CLOCKS;
+    t.delay = clocks > ADC_TRIGGER_MAX_DELAY ? ADC_TRIGGER_MAX_DELAY : clocks;
+    return t;
+}
+
+//the middle of the sample, PWM clocks from the period start (counter reload)
+inline uint16_t getSampleClock(const Trigger &t, uint16_t cmr)
+{
+    if(cmr > OUTPUT_PWM_PERIOD)
+        cmr = OUTPUT_PWM_PERIOD;
+    uint16_t clock = t.period ? 0 : OUTPUT_PWM_PERIOD - cmr;
+    clock += t.delay * ADC_TRIGGER_DELAY_PWM_CLOCKS + ADC_TRIGGER_SAMPLING_PWM_CLOCKS/2;
+    return clock % (OUTPUT_PWM_PERIOD + 1);
+}
+
+} // namespace AnalogInputsADCTrigger
+
+#endif /* ANALOG_INPUTS_ADC_TRIGGER_H_ */
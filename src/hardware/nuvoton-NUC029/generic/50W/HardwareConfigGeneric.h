@@ -42,6 +42,19 @@
 //#define ENABLE_TX_HW_SERIAL_PIN7_PIN38   // if set, need to adjust TX_HW_SERIAL_PIN in imaxB6-pins.h
 
 #define ENABLE_GET_PID_VALUE
+//PI(D) SMPS current loop with a feed-forward duty cycle at the start,
+//without it: the I only loop (see SMPS_PID.h)
+//#define ENABLE_SMPS_PID
+//preload the SMPS PID on a setpoint change, no current ramp, needs ENABLE_SMPS_PID (see SMPS_PID.cpp)
+//#define ENABLE_SMPS_FEED_FORWARD
+//second order noise shaping of the PWM modulator, optional dither (see outputPWMModulator.h)
+//#define ENABLE_OUTPUT_PWM_NOISE_SHAPING
+//#define ENABLE_OUTPUT_PWM_DITHER
+//hold the measured discharge current (see SMPS_PID.h)
+//#define ENABLE_DISCHARGER_PID
+//Ismps: one sample per PWM period, in the middle of the current ramp (see AnalogInputsADCTrigger.h)
+//not verified on the hardware yet
+//#define ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
 #define ENABLE_EXPERT_VOLTAGE_CALIBRATION
 #define ENABLE_T_INTERNAL
 
@@ -49,8 +62,12 @@
 
 #define ANALOG_INPUTS_ADC_BURST_COUNT           70
 #define ANALOG_INPUTS_ADC_ROUND_MAX_COUNT       100
-#define ANALOG_INPUTS_ADC_DELTA_SHIFT           4
 #define ANALOG_INPUTS_ADC_RESOLUTION_BITS       12
+//Cortex-M0: aligned 16/32 bit loads can't be torn by an interrupt
+#define ENABLE_ATOMIC_32BIT_READ
+#define ANALOG_INPUTS_ADC_SCALE_Ismps           2
+//integrate charge and energy after every ADC round
+#define ENABLE_ANALOG_INPUTS_ROUND_INTEGRATION
 
 //#define ANALOG_INPUTS_MAX_ADC_Vout_plus_pin (ANALOG_INPUTS_MAX_ADC_VALUE/2)
 #define ANALOG_INPUTS_MAX_ADC_Vout_plus_pin 25000
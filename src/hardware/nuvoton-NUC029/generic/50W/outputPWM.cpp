@@ -18,7 +18,11 @@
 
 #include "LcdPrint.h"
 #include "outputPWM.h"
+#include "outputPWMModulator.h"
 #include "irq_priority.h"
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+#include "AnalogInputsADCTrigger.h"
+#endif
 
 #define ENABLE_DEBUG
 #include "debug.h"
@@ -40,28 +44,52 @@ volatile uint32_t pwm_n;
 volatile uint32_t PWM_valueA = 0;
 volatile uint32_t PWM_valueB = 0;
 volatile uint32_t PWM_valueC = 0;
-volatile uint32_t PWM_sumA = 0;
-volatile uint32_t PWM_sumB = 0;
-volatile uint32_t PWM_sumC = 0;
+Modulator PWM_modulatorA;
+Modulator PWM_modulatorB;
+Modulator PWM_modulatorC;
+
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+volatile bool adcTrigger_ = false;
+
+//the channel that switches: boost (pin 20) if its PWM is on, otherwise buck (pin 19),
+//the trigger is set together with its CMR - both take effect in the next period
+void setADCTrigger(uint16_t cmrA, uint16_t cmrB)
+{
+    bool boost = SYS->P2_MFP & SYS_MFP_P21_PWM1;
+    uint8_t channel = boost ? PWM_CH1 : PWM_CH0;
+    AnalogInputsADCTrigger::Trigger t = AnalogInputsADCTrigger::get(boost ? cmrB : cmrA);
+    PWMA->TCON = (t.period ? PWM_PERIOD_TRIGGER_ADC : PWM_DUTY_TRIGGER_ADC) << channel;
+    ADC->ADTDCR = t.delay;
+}
+
+void enableADCTrigger(bool enable)
+{
+    adcTrigger_ = enable;
+    if(!enable)
+        PWMA->TCON = 0;
+}
+#endif
 
 void setCMR() {
     //modulate the PWM - we modulate the PWM signal to get more precision.
-    //(the PWM frequency stays at about 32kHz)
-    PWM_sumA+=PWM_valueA;
-    PWM_sumB+=PWM_valueB;
-    PWM_sumC+=PWM_valueC;
-
-    PWM_SET_CMR(PWMA, PWM_CH0, PWM_sumA/OUTPUT_PWM_PRECISION_FACTOR);
-    PWM_SET_CMR(PWMA, PWM_CH1, PWM_sumB/OUTPUT_PWM_PRECISION_FACTOR);
-    PWM_SET_CMR(PWMA, PWM_CH2, PWM_sumC/OUTPUT_PWM_PRECISION_FACTOR);
-
-    PWM_sumA%=OUTPUT_PWM_PRECISION_FACTOR;
-    PWM_sumB%=OUTPUT_PWM_PRECISION_FACTOR;
-    PWM_sumC%=OUTPUT_PWM_PRECISION_FACTOR;
+    //(the PWM frequency stays at about 32kHz, see outputPWMModulator.h)
+    uint16_t cmrA = PWM_modulatorA.next(PWM_valueA);
+    uint16_t cmrB = PWM_modulatorB.next(PWM_valueB);
+    PWM_SET_CMR(PWMA, PWM_CH0, cmrA);
+    PWM_SET_CMR(PWMA, PWM_CH1, cmrB);
+    PWM_SET_CMR(PWMA, PWM_CH2, PWM_modulatorC.next(PWM_valueC));
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+    if(adcTrigger_)
+        setADCTrigger(cmrA, cmrB);
+#endif
 }
 
 void initialize(void)
 {
+    PWM_modulatorA.reset();
+    PWM_modulatorB.reset();
+    PWM_modulatorC.reset();
+
     CLK_EnableModuleClock(PWM01_MODULE);
     CLK_EnableModuleClock(PWM23_MODULE);
     //CLK_EnableModuleClock(PWM67_MODULE);
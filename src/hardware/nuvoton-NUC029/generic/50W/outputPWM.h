@@ -31,6 +31,11 @@ namespace outputPWM {
     void setPWM(uint8_t pin, uint32_t value);
     void disablePWM(uint8_t pin);
 
+#ifdef ENABLE_ANALOG_INPUTS_ADC_PWM_TRIGGER
+    //the SMPS PWM starts the ADC, see AnalogInputsADCTrigger.h
+    void enableADCTrigger(bool enable);
+#endif
+
 } //namespace outputPWM
 
 
@@ -0,0 +1,102 @@
+/*
+    cheali-charger - open source firmware for a variety of LiPo chargers
+    Copyright (C) 2016 Paweł Stawicki. All right reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef OUTPUT_PWM_MODULATOR_H_
+#define OUTPUT_PWM_MODULATOR_H_
+
+#include <stdint.h>
+#include "outputPWM.h"
+
+/* PWM modulators: a duty cycle value (0 - OUTPUT_PWM_PRECISION_PERIOD) is
+ * OUTPUT_PWM_PRECISION_FACTOR times finer than the CMR, the modulator turns
+ * it into one CMR per PWM period (setCMR, the PWM interrupt) with the same
+ * average.
+ *  - Modulator1: first order, the quantization error is carried over to the
+ *    next period. A constant value gives a periodic CMR sequence: idle tones
+ *    down to 32kHz/OUTPUT_PWM_PRECISION_FACTOR (760Hz), in the band of the
+ *    SMPS current and the ADC
+ *  - Modulator2: second order error feedback, the quantization error is
+ *    shaped by (1 - z^-1)^2: less of it at low frequencies, more near 16kHz
+ *    where the inductor filters it out. With dither a LFSR adds
+ *    OUTPUT_PWM_DITHER_BITS of noise to the quantizer input (it is shaped
+ *    too), a constant value gives no periodic sequence.
+ * both cost one division per channel.
+ * Modulator is the one selected by ENABLE_OUTPUT_PWM_NOISE_SHAPING and
+ * ENABLE_OUTPUT_PWM_DITHER, see the host spectral benchmark (Benchmark.h).
+ */
+
+#ifndef OUTPUT_PWM_DITHER_BITS
+#define OUTPUT_PWM_DITHER_BITS  3
+#endif
+
+namespace outputPWM {
+
+struct Modulator1 {
+    uint32_t sum_;
+
+    void reset() { sum_ = 0; }
+    uint16_t next(uint32_t value) {
+        sum_ += value;
+        uint16_t cmr = sum_ / OUTPUT_PWM_PRECISION_FACTOR;
+        sum_ -= uint32_t(cmr) * OUTPUT_PWM_PRECISION_FACTOR;
+        return cmr;
+    }
+};
+
+template<bool dither>
+struct Modulator2 {
+    //the last two quantization errors (CMR * OUTPUT_PWM_PRECISION_FACTOR - input)
+    int16_t e1_, e2_;
+    uint16_t lfsr_;
+
+    void reset() { e1_ = e2_ = 0; lfsr_ = 0xace1; }
+    uint16_t next(uint32_t value) {
+        int32_t w = int32_t(value) - 2 * e1_ + e2_;
+        //round to the nearest CMR
+        int32_t q = w + OUTPUT_PWM_PRECISION_FACTOR / 2;
+        if(dither) {
+            //16 bit Galois LFSR, uniform +/- 2^(OUTPUT_PWM_DITHER_BITS-1)
+            lfsr_ = (lfsr_ >> 1) ^ (-(lfsr_ & 1) & 0xb400);
+            q += int16_t(lfsr_ & ((1 << OUTPUT_PWM_DITHER_BITS) - 1)) - (1 << (OUTPUT_PWM_DITHER_BITS - 1));
+        }
+        uint16_t cmr = 0;
+        if(q > 0) {
+            cmr = uint32_t(q) / OUTPUT_PWM_PRECISION_FACTOR;
+            if(cmr > OUTPUT_PWM_PERIOD)
+                cmr = OUTPUT_PWM_PERIOD;
+        }
+        int32_t e = int32_t(cmr) * OUTPUT_PWM_PRECISION_FACTOR - w;
+        //saturated (0 or 100%): don't wind up the error
+        if(e > OUTPUT_PWM_PRECISION_FACTOR) e = OUTPUT_PWM_PRECISION_FACTOR;
+        if(e < -OUTPUT_PWM_PRECISION_FACTOR) e = -OUTPUT_PWM_PRECISION_FACTOR;
+        e2_ = e1_;
+        e1_ = e;
+        return cmr;
+    }
+};
+
+#if defined(ENABLE_OUTPUT_PWM_NOISE_SHAPING) && defined(ENABLE_OUTPUT_PWM_DITHER)
+typedef Modulator2<true> Modulator;
+#elif defined(ENABLE_OUTPUT_PWM_NOISE_SHAPING)
+typedef Modulator2<false> Modulator;
+#else
+typedef Modulator1 Modulator;
+#endif
+
+} //namespace outputPWM
+
+#endif //OUTPUT_PWM_MODULATOR_H_
@@ -24,6 +24,8 @@
 
 #define ENABLE_HELPER
 #define ENABLE_HELPER_ANALOG_INPUTS_ANALYZER
+//raw ADC noise: sigma, ENOB, Allan deviation (AnalogInputsNoise.h)
+#define ENABLE_ANALOG_INPUTS_NOISE
 
 
 #define MAX_CHARGE_V            ANALOG_VOLT(27.000)